@@ -65,10 +65,10 @@ void preempt(bool state)
 }
 
 /**
-*      @brief Function to determine scheduling order
-*      @param state round robin or priority based
+*      @brief Function to select the scheduler policy
+*      @param policy name of the policy (prio, rr or stride), unknown names keep the current policy
 **/
-void priority(bool state)
+void sched(char *policy)
 {
     __asm(" SVC #0x11");                                    // Trigger a Service call
 }
@@ -98,4 +98,46 @@ void run(char *procName)
 void inheritance(bool state)
 {
     __asm(" SVC #0x18");                                    // Trigger a Service call
-}
\ No newline at end of file
+}
+
+#if CONFIG_POOLS
+/**
+ *      @brief Function to display the usage of the memory pools
+ *      @param poolInfo location to store the pool snapshot
+ **/
+void pools(void *poolInfo)
+{
+    __asm(" SVC #0x1B");                                    // Trigger a Service call
+}
+#endif
+
+/**
+ *      @brief Function to display the heap map and fragmentation
+ *      @param heapInfo location to store the heap snapshot
+ **/
+void meminfo(void *heapInfo)
+{
+    __asm(" SVC #0x1E");                                    // Trigger a Service call
+}
+
+#if CONFIG_PERIODIC_TASKS
+/**
+ *      @brief Function to display the timing statistics of the periodic threads
+ *      @param rtStatInfo location to store the statistics of every TCB record
+ **/
+void rtstat(void *rtStatInfo)
+{
+    __asm(" SVC #0x29");                                    // Trigger a Service call
+}
+#endif
+
+#if CONFIG_TRACE
+/**
+ *      @brief Function to copy the next records out of the trace ring
+ *      @param chunk position in the ring, filled with the records
+ **/
+void trace(void *chunk)
+{
+    __asm(" SVC #0x2A");                                    // Trigger a Service call
+}
+#endif
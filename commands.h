@@ -10,16 +10,27 @@
 
 #include <inttypes.h>
 #include <stdbool.h>
+#include "kernelConfig.h"
 
 void ps(void *ptr);             // Function to display the process (thread) status
 void ipcs(void *, void *);      // Function to display the inter-process (thread) communication status
 void kill(uint32_t pid);        // Function to kill the process (thread) with matching PID
 void Pkill(char *procName);     // Function to kill process (thread) with matching name
 void preempt(bool state);       // Function to toggle preemption state
-void priority(bool state);      // Function to determine scheduling order
+void sched(char *policy);       // Function to select the scheduler policy
 void pidof(char *, void *);     // Function to display the PID of given process
 void run(char *procName);       // Function to run selected program in the background
 void reboot(void);              // Function to reset the system
 void inheritance(bool state);   // Function to change priority inheritance mode
+#if CONFIG_POOLS
+void pools(void *poolInfo);     // Function to display the usage of the memory pools
+#endif
+void meminfo(void *heapInfo);   // Function to display the heap map and fragmentation
+#if CONFIG_PERIODIC_TASKS
+void rtstat(void *rtStatInfo);  // Function to display the timing statistics of the periodic threads
+#endif
+#if CONFIG_TRACE
+void trace(void *chunk);        // Function to copy the next records out of the trace ring
+#endif
 
 #endif
@@ -19,6 +19,7 @@
 // User added
 #include "strings.h"
 #include "systemRegisters.h"
+#include "kernel.h"
 
 extern uint32_t pidExtern_g;
 
@@ -39,6 +40,8 @@ void mpuFaultIsr(void)
     print((void *)&flags, "-> Fault Status", HEX);
     print((void *)&faultAddr, "-> Fault Address", HEX);
 
+    checkStackOverflow(flags, faultAddr);                   // Name the task if it ran off its stack
+
     print((void *)&psp[0], "-> R0", HEX);
     print((void *)&psp[1], "-> R1", HEX);
     print((void *)&psp[2], "-> R2", HEX);
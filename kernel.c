@@ -20,6 +20,12 @@
 #include "strings.h"
 #include "systemRegisters.h"
 #include "shell.h"
+#include "pool.h"
+#include "tlsf.h"
+#include "workers.h"
+#include "trace.h"
+
+#define     NULL                0x00000000
 
 #define     CURRENT_MUTEX       mutexes[tcb[taskCurrent].mutex]
 #define     FIRST_MUTEX         mutexes[0]
@@ -44,6 +50,27 @@
 #define     IPCS                0x16                // SVC number to get the status of IPC mechanisms
 #define     SETPRIORITY         0x17                // SVC number to update the priority of a thread
 #define     PRIORITY            0x18                // SVC number to update the priority inheritance state
+#define     POOL_ALLOC          0x19                // SVC number to allocate a block from a pool
+#define     POOL_FREE           0x1A                // SVC number to release a block to a pool
+#define     POOLS               0x1B                // SVC number to get the status of the memory pools
+#define     HEAP                0x1C                // SVC number to get the heap of the current thread
+#define     ATTACH              0x1D                // SVC number to map a shared memory object into the current thread
+#define     MEMINFO             0x1E                // SVC number to get a snapshot of the heap
+#define     EXIT                0x1F                // SVC number to end the current thread and release its memory
+#define     JOIN                0x20                // SVC number to wait for a thread to exit
+#define     SPAWN               0x21                // SVC number to create a thread from an unprivileged thread
+#define     SUBMIT_JOB          0x22                // SVC number to queue a job for the worker threads
+#define     TAKE_JOB            0x23                // SVC number for a worker to wait for its next job
+#define     SLICE               0x24                // SVC number to set the time slice of a priority level
+#define     THRESHOLD           0x25                // SVC number to update the preemption threshold of a thread
+#define     BUDGET              0x26                // SVC number to set the CPU budget of a thread
+#define     AGING               0x27                // SVC number to turn priority aging of a thread on or off
+#define     TICKETS             0x28                // SVC number to set the stride scheduler tickets of a thread
+#define     RTSTAT              0x29                // SVC number to get the timing statistics of the periodic threads
+#define     TRACE_READ          0x2A                // SVC number to copy records out of the trace ring
+
+#define     STACK_PAINT         0xC0DEC0DE          // Pattern filling unused stack words
+#define     TIMER_COUNTS_PER_US 40                  // WTIMER0 counts at the 40 MHz system clock
 
 mutex mutexes[MAX_MUTEXES];                         // Instantiate mutex globally
 semaphore semaphores[MAX_SEMAPHORES];               // Instantiate mutex globally
@@ -56,6 +83,20 @@ semaphore semaphores[MAX_SEMAPHORES];               // Instantiate mutex globall
 #define STATE_DELAYED           4                   // has run, but now awaiting timer
 #define STATE_BLOCKED_MUTEX     5                   // has run, but now blocked by semaphore
 #define STATE_BLOCKED_SEMAPHORE 6                   // has run, but now blocked by semaphore
+#define STATE_BLOCKED_JOIN      7                   // has run, but now waiting for another thread to exit
+#define STATE_BLOCKED_JOB       8                   // worker waiting for the job queue
+#define STATE_THROTTLED         9                   // used up its CPU budget, waiting for the next period
+
+#define THREAD_HANDLE(task)     (THREAD_HANDLE_TAG | ((uint32_t)tcb[task].generation << 8) | (task))
+
+#define TASK_NAME_LENGTH        16                  // size of the name field, longer names are cut
+
+// priority below which other tasks may preempt the task, never less urgent than its own priority
+#define PREEMPT_LIMIT(task)     (THRESHOLD_RAISED(task) ? tcb[task].threshold : tcb[task].currentPriority)
+#define PASS_BEFORE(a, b)       ((int32_t)((a) - (b)) < 0)          // stride pass, wrap safe while passes stay within 2^31
+#define STRIDE_CHARGE_LIMIT     ((1UL << 30) / STRIDE_ONE)          // units charged at most per switch, keeps one charge under 2^30
+
+#define THRESHOLD_RAISED(task)  (tcb[task].threshold < tcb[task].currentPriority && !tcb[task].throttled)
 
 // PS
 uint8_t activeFillIndex_g = 0;
@@ -67,33 +108,161 @@ uint32_t pidExtern_g = 0;
 // task
 uint8_t taskCurrent = 0;                            // index of last dispatched task
 uint8_t taskCount = 0;                              // total number of valid tasks
+uint8_t nameBuckets_g[NAME_BUCKETS];                // first task in each bucket of the name index, MAX_TASKS if empty
+
+// time slicing
+uint16_t timeSlice_g[NUM_PRIORITIES];               // ticks a task runs before an equal priority task gets the CPU
+uint16_t sliceLeft_g = 0;                           // ticks left in the slice of the running task
+
+#if CONFIG_CPU_BUDGETS
+// CPU budgets
+uint16_t budgetPeriodLeft_g = BUDGET_PERIOD;        // ticks until every budget is replenished
+#endif
+
+#if CONFIG_STRIDE_SCHEDULER
+// stride scheduling
+uint8_t strideHeap_g[MAX_TASKS];                    // live tasks ordered by pass, a binary min-heap
+uint8_t strideHeapSize_g = 0;                       // number of tasks in the heap
+uint32_t globalPass_g = 0;                          // pass of the last task picked, tasks rejoining start here
+#endif
+
+#if CONFIG_PERIODIC_TASKS || CONFIG_TRACE
+// kernel time, the timer only runs while a task does
+uint32_t kernelTime_g = 0;                          // timer counts run by every task up to the last switch
+
+#define KERNEL_TIME()           (kernelTime_g + ((WTIMER0_CTL_R & TIMER_CTL_TAEN) ? WTIMER0_TAV_R : 0))  // wraps every 107 s
+#endif
+
+#if CONFIG_TRACE
+uint8_t switchedOut_g = 0;                          // task running when pendSvIsr was entered
+
+#define TRACE(event, task, object)  traceEvent(event, task, object, KERNEL_TIME())
+#else
+#define TRACE(event, task, object)
+#endif
+
+#if CONFIG_PRIORITY_AGING
+#define END_AGING(task)         (tcb[task].aged = false)    // currentPriority set outright, no raise left to undo
+#else
+#define END_AGING(task)
+#endif
 
 // control
-bool priorityScheduler = true;                      // priority (true) or round-robin (false)
 bool priorityInheritance = false;                   // priority inheritance for mutexes
 bool preemption = false;                            // preemption (true) or cooperative (false)
 
 // Task Control Block
-#define NUM_PRIORITIES   8
 struct _tcb
 {
-    void *pid;                                      // used to uniquely identify thread (add of task fn)
+    void *pid;                                      // entry point of the thread (add of task fn)
+    void *arg;                                      // argument passed to the entry point
+    uint16_t generation;                            // bumped on every reuse of the record so stale handles are rejected
     void *spInit;                                   // original top of stack
     void *sp;                                       // current stack pointer
+    void *stackBase;                                // lowest address of the stack (painted at creation)
+#if CONFIG_THREAD_HEAPS
+    tlsf_t *heap;                                   // private heap above the stack (NULL if none)
+#endif
     uint32_t ticks;                                 // ticks until sleep complete
-    uint32_t scheduledCount;                        // To keep track of how many times the task was scheduled
+    uint32_t switches[2];                           // To hold the number of times the task was switched in
     uint32_t runTime[2];                            // To hold the runTime values
 
     uint8_t state;                                  // see STATE_ values above
     uint8_t priority;                               // 0=highest
     uint8_t currentPriority;                        // 0=highest (needed for pi)
+    uint8_t threshold;                              // only tasks of higher priority than this may preempt it
+#if CONFIG_CPU_BUDGETS
+    uint32_t budget;                                // timer counts the task may run per budget period (0 = unlimited)
+    uint32_t budgetUsed;                            // timer counts used in the current budget period
+    bool budgetSuspend;                             // suspend (true) or demote to the lowest priority (false) once used up
+#endif
+    bool throttled;                                 // budget used up, held back until the next period
+#if CONFIG_STRIDE_SCHEDULER
+    uint16_t tickets;                               // share of the CPU under the stride scheduler
+    uint32_t stride;                                // pass added per unit of CPU time, STRIDE_ONE / tickets
+    uint32_t pass;                                  // virtual time, the lowest ready pass runs next
+    uint8_t heapPos;                                // position in strideHeap_g
+#endif
+#if CONFIG_PERIODIC_TASKS
+    uint32_t periodUs;                              // release period of a periodic task, 0 for other tasks
+    uint32_t wcetUs;                                // declared worst-case execution time per period
+    bool autoPriority;                              // priority assigned rate-monotonically
+    bool released;                                  // a job has been released and has not completed yet
+    bool missed;                                    // the current job is past its deadline
+    uint32_t releaseTime;                           // kernel time the current job was released
+    uint32_t jobCounts;                             // timer counts the current job has run
+    uint32_t jobs;                                  // jobs completed
+    uint32_t misses;                                // jobs that ran past the end of their period
+    uint32_t execMax;                               // longest execution of a job in timer counts
+    uint32_t responseMin;                           // shortest release to completion time in timer counts
+    uint32_t responseMax;                           // longest release to completion time in timer counts
+    uint64_t responseSum;                           // sum of the response times, for the average
+#endif
+#if CONFIG_PRIORITY_AGING
+    bool aging;                                     // currentPriority rises while the task waits to run
+    bool aged;                                      // currentPriority was raised by aging
+    uint8_t agedFrom;                               // currentPriority before aging, an inherited priority included
+    uint16_t waitTicks;                             // ticks spent ready since the last raise or run
+#endif
     uint8_t runInstances;                           // Number of instances task was scheduled
-    uint8_t srd[NUM_SRAM_REGIONS];                  // MPU subregion disable bits
-    char name[16];                                  // name of task used in ps command
+    taskMpu_t mpu;                                  // MPU stack region or subregion disable bits
+    char name[TASK_NAME_LENGTH];                    // name of task used in ps command
+    uint16_t nameHash;                              // hash of name, compared before the name itself
+    uint8_t nextName;                               // next task in the same name bucket, MAX_TASKS at the end
     uint8_t mutex;                                  // index of the mutex in use or blocking the thread
     uint8_t semaphore;                              // index of the semaphore that is blocking the thread
+    uint8_t join;                                   // index of the thread being joined
+#if CONFIG_WORKERS
+    job_t *jobSlot;                                 // where a waiting worker wants its next job
+#endif
 } tcb[MAX_TASKS];
 
+// Scheduler policy, every hook runs in handler mode with the TCB table consistent
+typedef struct
+{
+    const char *name;                               // name selected with the sched command
+    void (*enqueue)(uint8_t task);                  // task record created, or policy selected with the task alive
+    void (*dequeue)(uint8_t task);                  // task record released, or policy deselected
+    uint8_t (*pickNext)(void);                      // task to run next, taskCurrent to keep it running
+    bool (*tick)(void);                             // systick with a task running, true to reschedule
+    void (*yield)(void);                            // running task gave up the CPU
+    void (*charge)(uint8_t task, uint32_t counts);  // timer counts used by the task being switched out (NULL if unused)
+} schedPolicy_t;
+
+#if CONFIG_PERIODIC_TASKS
+// Periodic task as seen by the schedulability test
+typedef struct
+{
+    uint32_t periodUs;
+    uint32_t wcetUs;
+    uint8_t priority;
+    bool autoPriority;
+} rtTask_t;
+
+// Liu-Layland bound n(2^(1/n) - 1) in per-mille for n = 1 to 10, larger sets use the limit ln 2
+const uint16_t liuLayland_g[10] = {1000, 828, 779, 756, 743, 734, 728, 724, 720, 717};
+#define LIU_LAYLAND_LIMIT       693
+#endif
+
+// Thread creation request passed to the kernel by unprivileged threads
+typedef struct
+{
+    _fn fn;
+    void *arg;
+    const char *name;
+    uint8_t priority;
+    uint32_t stackBytes;
+    thread_t handle;                                // filled in by the kernel, 0 on failure
+} threadRequest_t;
+
+// kernel SRAM budget, the static tables and the system stack must fit KERNEL_SRAM_SIZE (sramConfig.h)
+// the reserve covers the scalars, the policy tables, struct padding and the run-time library
+#define KERNEL_SRAM_RESERVE     384
+#define KERNEL_SRAM_USED        (sizeof(tcb) + sizeof(mutexes) + sizeof(semaphores) + sizeof(timeSlice_g) + sizeof(nameBuckets_g) \
+                                 + MM_SRAM_BYTES + TRACE_SRAM_BYTES + WORKERS_SRAM_BYTES + SYSTEM_STACK_SIZE + KERNEL_SRAM_RESERVE)
+
+typedef char kernelSramCheck[(KERNEL_SRAM_USED <= KERNEL_SRAM_SIZE) ? 1 : -1];     // turn features off or grow KERNEL_SRAM_SIZE
+
 /**
 *      @brief Function to initialize the mutex structure
 *      @param mutex to be initialized
@@ -169,78 +338,339 @@ void initRtos(void)
     {
         tcb[i].state = STATE_INVALID;
         tcb[i].pid = 0;
+        tcb[i].generation = 0;
+    }
+
+    for (i = 0; i < NAME_BUCKETS; i++)          // Empty name index
+    {
+        nameBuckets_g[i] = MAX_TASKS;
+    }
+
+    for (i = 0; i < NUM_PRIORITIES; i++)        // Same slice at every level until changed
+    {
+        timeSlice_g[i] = DEFAULT_TIME_SLICE;
     }
 }
 
+#if CONFIG_STRIDE_SCHEDULER
 /**
-*      @brief Priority Task Scheduler with round robin for tasks with same priority
-*      @return uint8_t task to be executed
+*      @brief Function to swap two entries of the stride heap
+*      @param a position of the first entry
+*      @param b position of the second entry
 **/
-uint8_t rtosScheduler(void)
+void strideSwap(uint8_t a, uint8_t b)
+{
+    uint8_t task = strideHeap_g[a];
+
+    strideHeap_g[a] = strideHeap_g[b];
+    strideHeap_g[b] = task;
+    tcb[strideHeap_g[a]].heapPos = a;
+    tcb[strideHeap_g[b]].heapPos = b;
+}
+
+/**
+*      @brief Function to move an entry of the stride heap towards the top while its pass is lower than its parent's
+*      @param pos position of the entry
+**/
+void strideSiftUp(uint8_t pos)
 {
-    // Use priority scheduler
-    if (priorityScheduler)
+    while (pos && PASS_BEFORE(tcb[strideHeap_g[pos]].pass, tcb[strideHeap_g[(pos - 1) / 2]].pass))
     {
-        uint8_t currentHighestPriority = 0xFF;                                          // Arbitrarily high value
-        uint8_t highestPriorityTask;
-        uint8_t taskP;
+        strideSwap(pos, (pos - 1) / 2);
+        pos = (pos - 1) / 2;
+    }
+}
 
-        for (taskP = 0; taskP < MAX_TASKS; taskP++)                                     // Iterate through all tasks
-        {
-            if (tcb[taskP].state == STATE_READY || tcb[taskP].state == STATE_UNRUN)     // Find READY and UNRUN tasks
-            {
-                if (tcb[taskP].currentPriority < currentHighestPriority)                // Find the priority
-                {
-                    currentHighestPriority = tcb[taskP].currentPriority;                // Update the current highest priority
-                    highestPriorityTask = taskP;                                        // Update the current task
-                }
+/**
+*      @brief Function to move an entry of the stride heap towards the bottom while a child has a lower pass
+*      @param pos position of the entry
+**/
+void strideSiftDown(uint8_t pos)
+{
+    uint16_t child;
 
-                else if (tcb[taskP].currentPriority == currentHighestPriority)          // If there are two ready tasks with same priority
-                {
-                    // Find the one that was scheduled fewer times
-                    if (tcb[taskP].scheduledCount < tcb[highestPriorityTask].scheduledCount)
-                    {
-                        highestPriorityTask = taskP;
-                    }
-                }
-            }
+    while ((child = 2 * pos + 1) < strideHeapSize_g)
+    {
+        if (child + 1 < strideHeapSize_g && PASS_BEFORE(tcb[strideHeap_g[child + 1]].pass, tcb[strideHeap_g[child]].pass))
+        {
+            child++;                                                                    // Lower of the two children
         }
-        taskCurrent = highestPriorityTask;
+        if (!PASS_BEFORE(tcb[strideHeap_g[child]].pass, tcb[strideHeap_g[pos]].pass))   break;
+
+        strideSwap(pos, child);
+        pos = child;
+    }
+}
+
+/**
+*      @brief Function to add a task to the stride heap
+*      @param task index of the TCB record
+**/
+void strideInsert(uint8_t task)
+{
+    strideHeap_g[strideHeapSize_g] = task;
+    tcb[task].heapPos = strideHeapSize_g;
+    strideSiftUp(strideHeapSize_g++);
+}
 
-        tcb[taskCurrent].scheduledCount++;                                              // Increment the schedule count
+/**
+*      @brief Function to take a task out of the stride heap
+*      @param task index of the TCB record
+**/
+void strideRemove(uint8_t task)
+{
+    uint8_t pos = tcb[task].heapPos;
 
-        return taskCurrent;                                                             // Return the task to be updated
+    strideSwap(pos, --strideHeapSize_g);                                                // Last entry fills the hole
+    if (pos < strideHeapSize_g)
+    {
+        strideSiftDown(pos);
+        strideSiftUp(pos);
     }
+}
 
-    // Use round-robin scheduler
-    else
+/**
+*      @brief Function to charge a task for the CPU time it used, in proportion to its stride
+*      @param task index of the TCB record
+*      @param counts timer counts the task ran for since it was switched in
+**/
+void chargePass(uint8_t task, uint32_t counts)
+{
+    uint32_t units = counts >> STRIDE_COUNT_SHIFT;
+
+    if (units > STRIDE_CHARGE_LIMIT)    units = STRIDE_CHARGE_LIMIT;                    // A long run without preemption
+    tcb[task].pass += units * tcb[task].stride;
+    strideSiftDown(tcb[task].heapPos);                                                  // Pass only grows
+}
+
+/**
+*      @brief Function to pick the ready task with the lowest pass
+*              Tasks at the lowest priority level (idle) only run when no other task is ready, and a task that
+*              was away (blocked or sleeping) rejoins at the current pass instead of catching up on the time it missed
+*              Every entry behind the current pass is pulled up to it, ready or not, so no pass lags far enough to wrap
+*      @return uint8_t index of the task, MAX_TASKS if none is ready
+**/
+uint8_t strideNext(void)
+{
+    uint8_t aside[MAX_TASKS];                                                           // Entries popped while searching
+    uint8_t asideCount = 0;
+    uint8_t background = MAX_TASKS;
+    uint8_t next = MAX_TASKS;
+    uint8_t task;
+
+    while (strideHeapSize_g && next == MAX_TASKS)
     {
-        bool ok = false;
-        static uint8_t task = 0xFF;                                                     // Arbitrarily high value
+        task = strideHeap_g[0];
 
-        while (!ok)                                                                     // Iterate over all tasks starting from last task
+        if (PASS_BEFORE(tcb[task].pass, globalPass_g))
         {
-            task++;
-            if (task >= MAX_TASKS)      task = 0;                                       // Roll over task count
-            ok = (tcb[task].state == STATE_READY || tcb[task].state == STATE_UNRUN);    // Schedule READY or UNRUN task
+            tcb[task].pass = globalPass_g;                                              // No credit for time away
+            strideSiftDown(0);
+            continue;
         }
 
-        taskCurrent = task;                                                             // Update the current task
-        tcb[taskCurrent].scheduledCount++;                                              // Increment the schedule count
+        strideRemove(task);
+        aside[asideCount++] = task;
+
+        if (tcb[task].state != STATE_READY && tcb[task].state != STATE_UNRUN)    continue;
+
+        if (tcb[task].currentPriority == NUM_PRIORITIES - 1)                            // Background work waits for the others
+        {
+            if (background == MAX_TASKS)    background = task;
+            continue;
+        }
+
+        next = task;
+        globalPass_g = tcb[task].pass;
+    }
+
+    while (asideCount)  strideInsert(aside[--asideCount]);                              // Put back everything popped
+
+    return (next < MAX_TASKS) ? next : background;
+}
+#endif
+
+/**
+*      @brief Hook for policies without a run queue of their own, every pick scans the TCB table
+*      @param task index of the TCB record
+**/
+void noQueue(uint8_t task)
+{
+}
+
+/**
+*      @brief Time slice tick shared by every policy
+*              A raised preemption threshold holds the slice
+*      @return true once the slice of the running task is used up
+**/
+bool sliceTick(void)
+{
+    if (sliceLeft_g && !THRESHOLD_RAISED(taskCurrent))  sliceLeft_g--;                 // Charge the running task
+    return !sliceLeft_g;
+}
+
+/**
+*      @brief Yield shared by every policy, the running task gives up the rest of its slice
+**/
+void sliceYield(void)
+{
+    sliceLeft_g = 0;
+}
 
-        return taskCurrent;                                                             // Return the task count
+/**
+*      @brief Priority policy, with round robin for tasks with same priority
+*              The running task keeps the CPU until its time slice runs out, it blocks or yields,
+*              or a task of higher priority than its preemption threshold is ready. Equal priority tasks then take turns in TCB order
+*      @return uint8_t task to be executed
+**/
+uint8_t priorityPick(void)
+{
+    uint8_t currentHighestPriority = 0xFF;                                              // Arbitrarily high value
+    uint8_t next = taskCurrent;
+    uint8_t task;
+    uint16_t n;
+
+    for (n = 1; n <= MAX_TASKS; n++)                                                    // Start after the running task so it is considered last
+    {
+        task = (taskCurrent + n) % MAX_TASKS;
+        if ((tcb[task].state == STATE_READY || tcb[task].state == STATE_UNRUN)          // Find READY and UNRUN tasks
+            && tcb[task].currentPriority < currentHighestPriority)                      // First one found wins its priority
+        {
+            currentHighestPriority = tcb[task].currentPriority;                         // Update the current highest priority
+            next = task;                                                                // Update the current task
+        }
+    }
+
+    // Only a priority above the threshold cuts the slice short
+    if (tcb[taskCurrent].state == STATE_READY && sliceLeft_g && PREEMPT_LIMIT(taskCurrent) <= currentHighestPriority)
+    {
+        return taskCurrent;
     }
+    return next;
+}
+
+/**
+*      @brief Round-robin policy, every ready task gets a time slice in TCB order regardless of priority
+*      @return uint8_t task to be executed
+**/
+uint8_t roundRobinPick(void)
+{
+    uint8_t task;
+    uint16_t n;
+
+    if (tcb[taskCurrent].state == STATE_READY && sliceLeft_g)   return taskCurrent;    // Running task has time left
+
+    for (n = 1; n <= MAX_TASKS; n++)                                                    // Iterate over all tasks starting from last task
+    {
+        task = (taskCurrent + n) % MAX_TASKS;
+        if (tcb[task].state == STATE_READY || tcb[task].state == STATE_UNRUN)   return task;    // Schedule READY or UNRUN task
+    }
+    return taskCurrent;
+}
+
+#if CONFIG_STRIDE_SCHEDULER
+/**
+*      @brief Stride policy, the ready task with the lowest pass gets the next time slice
+*      @return uint8_t task to be executed
+**/
+uint8_t stridePick(void)
+{
+    uint8_t task;
+
+    if (tcb[taskCurrent].state == STATE_READY && sliceLeft_g)   return taskCurrent;    // Running task has time left
+
+    task = strideNext();
+    return (task < MAX_TASKS) ? task : taskCurrent;
+}
+#endif
+
+const schedPolicy_t priorityPolicy_g    = {"prio", noQueue, noQueue, priorityPick, sliceTick, sliceYield, NULL};
+const schedPolicy_t roundRobinPolicy_g  = {"rr", noQueue, noQueue, roundRobinPick, sliceTick, sliceYield, NULL};
+#if CONFIG_STRIDE_SCHEDULER
+const schedPolicy_t stridePolicy_g      = {"stride", strideInsert, strideRemove, stridePick, sliceTick, sliceYield, chargePass};
+#endif
+
+// Policies selectable with the sched command
+const schedPolicy_t *policies_g[] =
+{
+    &priorityPolicy_g,
+    &roundRobinPolicy_g,
+#if CONFIG_STRIDE_SCHEDULER
+    &stridePolicy_g,
+#endif
+};
+#define NUM_POLICIES    (sizeof(policies_g) / sizeof(policies_g[0]))
+
+const schedPolicy_t *policy_g = &priorityPolicy_g;                                     // Policy in use
+
+/**
+*      @brief Function to switch to another scheduler policy, live tasks move over to its run queue
+*      @param policy to be used from now on
+**/
+void setPolicy(const schedPolicy_t *policy)
+{
+    uint8_t i;
+
+    for (i = 0; i < MAX_TASKS; i++)
+    {
+        if (tcb[i].state != STATE_INVALID)  policy_g->dequeue(i);
+    }
+
+    policy_g = policy;
+
+    for (i = 0; i < MAX_TASKS; i++)
+    {
+        if (tcb[i].state != STATE_INVALID)  policy_g->enqueue(i);
+    }
+    sliceLeft_g = 0;                                                                    // Start the new policy with a fresh pick
+}
+
+/**
+*      @brief Task Scheduler, asks the policy in use for the next task
+*              A task kept running carries on with its slice, any other pick starts a new slice
+*      @return uint8_t task to be executed
+**/
+uint8_t rtosScheduler(void)
+{
+    uint8_t next = policy_g->pickNext();
+
+#if CONFIG_CPU_BUDGETS
+    while (tcb[next].throttled && tcb[next].budgetSuspend && tcb[next].state == STATE_READY)
+    {
+        tcb[next].state = STATE_THROTTLED;                                              // Overran, then woke before the next period
+        next = policy_g->pickNext();
+    }
+#endif
+
+    if (next == taskCurrent && tcb[taskCurrent].state == STATE_READY && sliceLeft_g)   return taskCurrent;
+
+    if (next != taskCurrent)    tcb[next].switches[activeFillIndex_g]++;               // Count the switch for ps
+
+#if CONFIG_PRIORITY_AGING
+    if (tcb[next].aged)                                                                 // Running resets the aging
+    {
+        tcb[next].currentPriority = tcb[next].agedFrom;                                 // Keeps an inherited priority
+        tcb[next].aged = false;
+    }
+    tcb[next].waitTicks = 0;
+#endif
+    taskCurrent = next;                                                                 // Update the current task
+    sliceLeft_g = timeSlice_g[tcb[taskCurrent].currentPriority];                        // Start a new slice
+
+    return taskCurrent;                                                                 // Return the task to be updated
 }
 
 /**
  *      @brief Function to spawn a method in unprivileged mode
  *      @param fn address of the function to be spawned
  *              The argument being passed will ensure that the PC has the value of the method to be executed
+ *      @param arg argument handed to the method
  **/
-void spawn(_fn fn)
+void spawn(_fn fn, void *arg)
 {
     disablePrivilegedMode();                // Enable the TMPL bit in the CONTROL register
-    fn();                                   // Call the method
+    fn(arg);                                // Call the method
+    threadExit();                           // Release the thread if the method returns
 }
 
 /**
@@ -259,10 +689,474 @@ void startRtos(void)
     tcb[task].state = STATE_READY;          // Update the status of the thread
     fn = (_fn)taskPID;                      // Assign locally
 
-    applySrdRules(tcb[task].srd);           // Apply the SRD rules specific to the first thread
+    applyTaskMpu(&tcb[task].mpu);           // Apply the MPU rules specific to the first thread
     stageMethod((uint32_t)tcb[task].sp);    // Load stack pointer onto PSP register and set ASP bit in Control register
 
-    spawn(fn);                              // Invoke function to spawn method
+    spawn(fn, tcb[task].arg);               // Invoke function to spawn method
+}
+
+/**
+*      @brief Function to fill a stack with the paint pattern so its usage can be measured later
+*      @param base lowest address of the stack
+*      @param top address just above the stack
+**/
+void paintStack(void *base, void *top)
+{
+    uint32_t *word;
+
+    for (word = (uint32_t *)base; word < (uint32_t *)top; word++)
+    {
+        *word = STACK_PAINT;
+    }
+}
+
+/**
+*      @brief Function to measure the deepest point a task's stack has reached
+*               Stacks grow down, so the first word from the bottom that lost the paint is the high-water mark
+*      @param task index of the task
+*      @return uint32_t number of stack bytes ever used
+**/
+uint32_t getStackUsed(uint8_t task)
+{
+    uint32_t *word = (uint32_t *)tcb[task].stackBase;
+
+    while (word < (uint32_t *)tcb[task].spInit && *word == STACK_PAINT)    word++;
+
+    return (uint32_t)tcb[task].spInit - (uint32_t)word;
+}
+
+/**
+*      @brief Function to tell whether an MPU fault was caused by the current task overflowing its stack
+*               The task is reported by name, PendSV then stops it
+*      @param flags fault status register value
+*      @param faultAddr fault address register value
+*      @return true if the fault hit the stack guard
+**/
+bool checkStackOverflow(uint32_t flags, uint32_t faultAddr)
+{
+    uint32_t guardTop = (uint32_t)tcb[taskCurrent].stackBase;
+    uint32_t guardBase = guardTop - tcb[taskCurrent].mpu.guardSize;
+    bool overflow = false;
+
+    if (!tcb[taskCurrent].mpu.guardSize)    return false;
+
+    if (flags & NVIC_FAULT_STAT_MSTKE)              overflow = true;                // Exception frame did not fit on the stack
+    else if (flags & NVIC_FAULT_STAT_MMARV)         overflow = (faultAddr >= guardBase && faultAddr < guardTop);
+
+    if (overflow)   print((void *)tcb[taskCurrent].name, "-> Stack overflow", CHAR);
+
+    return overflow;
+}
+
+/**
+ *      @brief Function to hash a task name (FNV-1a)
+ *              Only the characters that fit in the name field count, so the cost is bounded for any input
+ *      @param name to be hashed
+ *      @return uint16_t hash of the name
+ **/
+uint16_t hashName(const char name[])
+{
+    uint32_t hash = 2166136261u;
+    uint8_t i;
+
+    for (i = 0; i < (TASK_NAME_LENGTH - 1) && name[i]; i++)
+    {
+        hash = (hash ^ (uint8_t)name[i]) * 16777619u;
+    }
+    return (uint16_t)(hash ^ (hash >> 16));                                         // Fold the upper half in
+}
+
+/**
+ *      @brief Function to compare an input against a stored task name, up to the length of the name field
+ *      @param name stored in a TCB record
+ *      @param input name to compare
+ *      @return true if they match
+ **/
+bool matchName(const char name[], const char input[])
+{
+    uint8_t i;
+
+    for (i = 0; i < (TASK_NAME_LENGTH - 1); i++)
+    {
+        if (name[i] != input[i])    return false;
+        if (!name[i])               return true;
+    }
+    return true;
+}
+
+/**
+ *      @brief Function to add a TCB record to the name index
+ *      @param task index of the TCB record, its name must already be stored
+ **/
+void indexName(uint8_t task)
+{
+    uint8_t bucket;
+
+    tcb[task].nameHash  = hashName(tcb[task].name);
+    bucket              = tcb[task].nameHash & (NAME_BUCKETS - 1);
+    tcb[task].nextName  = nameBuckets_g[bucket];                                    // Push onto the bucket
+    nameBuckets_g[bucket] = task;
+}
+
+/**
+ *      @brief Function to remove a TCB record from the name index
+ *      @param task index of the TCB record
+ **/
+void unindexName(uint8_t task)
+{
+    uint8_t *link = &nameBuckets_g[tcb[task].nameHash & (NAME_BUCKETS - 1)];
+
+    while (*link < MAX_TASKS && *link != task)  link = &tcb[*link].nextName;        // Find the link pointing at the task
+    if (*link == task)  *link = tcb[task].nextName;
+}
+
+/**
+ *      @brief Function to find a thread by name through the name index
+ *              Only records in the same bucket with the same hash are compared, so the cost does not grow with the task count
+ *      @param name of the thread
+ *      @param after index of the previous match to continue from, MAX_TASKS to find the first
+ *      @return uint8_t index of the TCB record, MAX_TASKS if there is no (further) match
+ **/
+uint8_t findThreadByName(const char name[], uint8_t after)
+{
+    uint16_t hash = hashName(name);
+    uint8_t i = (after < MAX_TASKS) ? tcb[after].nextName : nameBuckets_g[hash & (NAME_BUCKETS - 1)];
+
+    while (i < MAX_TASKS && !(tcb[i].nameHash == hash && matchName(tcb[i].name, name)))
+    {
+        i = tcb[i].nextName;
+    }
+    return i;
+}
+
+/**
+ *      @brief Function to check whether a function already has a thread
+ *      @param fn pointer to the thread function
+ *      @return true if a TCB record holds fn
+ **/
+bool isThread(_fn fn)
+{
+    uint8_t i;
+
+    for (i = 0; i < MAX_TASKS; i++)
+    {
+        if (tcb[i].pid == fn)   return true;
+    }
+    return false;
+}
+
+/**
+ *      @brief Function to find the TCB record of a thread
+ *              Handles are checked in constant time, anything else is taken as the address of the thread function
+ *      @param id handle of the thread or address of its function
+ *      @return uint8_t index of the TCB record, MAX_TASKS if there is none or the handle is stale
+ **/
+uint8_t findThread(uint32_t id)
+{
+    uint8_t i = id & 0xFF;
+
+    if ((id & 0xFF000000) == THREAD_HANDLE_TAG)
+    {
+        if (i < MAX_TASKS && tcb[i].state != STATE_INVALID && id == THREAD_HANDLE(i))   return i;
+        return MAX_TASKS;
+    }
+
+    for (i = 0; i < MAX_TASKS; i++)
+    {
+        if (tcb[i].state != STATE_INVALID && (uint32_t)tcb[i].pid == id)    break;
+    }
+    return i;
+}
+
+/**
+ *      @brief Function to fill a TCB record for a new thread
+ *              The memory is laid out as guard, stack and heap, from the bottom up
+ *      @param i index of the TCB record
+ *      @param fn pointer to the thread function
+ *      @param name of the thread
+ *      @param priority to be allocated to the thread
+ *      @param memory base of the memory backing the thread
+ *      @param guardBytes size of the guard at the bottom of the memory (0 for none)
+ *      @param totalBytes size of the stack and heap above the guard
+ *      @param heapBytes number of bytes at the top of the memory used as the thread's heap (0 for none)
+ *      @param arg argument passed to the entry point
+ *      @return thread_t handle of the thread
+ **/
+thread_t setupTcb(uint8_t i, _fn fn, const char name[], uint8_t priority, void *memory, uint32_t guardBytes, uint32_t totalBytes, uint32_t heapBytes, void *arg)
+{
+    uint32_t stackTop = (uint32_t)memory + guardBytes + totalBytes - heapBytes;     // Heap sits above the stack
+
+    uint8_t j;
+
+    generateTaskMpu(memory, guardBytes + totalBytes, guardBytes, &tcb[i].mpu);      // Store MPU rules in the TCB
+    if (priority >= NUM_PRIORITIES)     priority = NUM_PRIORITIES - 1;              // Lowest level
+
+    for (j = 0; j < (TASK_NAME_LENGTH - 1) && name[j]; j++)                         // Store name, cut to the field
+    {
+        tcb[i].name[j] = name[j];
+    }
+    tcb[i].name[j] = '\0';
+    indexName(i);
+    tcb[i].state        = STATE_UNRUN;                                              // Store initial state as Un-Run
+    tcb[i].pid          = fn;                                                       // Store PID
+    tcb[i].arg          = arg;                                                      // Handed over in R0 on the first run
+    if (!++tcb[i].generation)   tcb[i].generation = 1;                              // Invalidate handles to the old thread
+    tcb[i].sp           = (void *)stackTop;                                         // ptr + (size in hex)
+    tcb[i].spInit       = (void *)stackTop;                                         // ptr + (size in hex)
+    tcb[i].stackBase    = (void *)((uint32_t)memory + guardBytes);                  // Stack starts above the guard
+#if CONFIG_THREAD_HEAPS
+    tcb[i].heap         = NULL;                                                     // Set by createThreadWithHeap
+#endif
+    tcb[i].priority     = priority;                                                 // Store the requested PID
+    tcb[i].currentPriority  = priority;                                             // Store the requested PID
+    tcb[i].threshold    = priority;                                                 // Plain priority preemption
+    tcb[i].throttled    = false;
+#if CONFIG_STRIDE_SCHEDULER
+    tcb[i].tickets      = DEFAULT_TICKETS;
+    tcb[i].stride       = STRIDE_ONE / DEFAULT_TICKETS;
+    tcb[i].pass         = globalPass_g;                                             // Start level with the running tasks
+#endif
+#if CONFIG_PERIODIC_TASKS
+    tcb[i].periodUs     = 0;                                                        // Set by createPeriodicThread
+    tcb[i].wcetUs       = 0;
+    tcb[i].autoPriority = false;
+    tcb[i].released     = false;                                                    // The first job starts with the thread
+    tcb[i].jobs         = 0;
+    tcb[i].misses       = 0;
+    tcb[i].execMax      = 0;
+    tcb[i].responseMin  = 0xFFFFFFFF;
+    tcb[i].responseMax  = 0;
+    tcb[i].responseSum  = 0;
+#endif
+#if CONFIG_PRIORITY_AGING
+    tcb[i].aging        = false;                                                    // Opt in with setThreadAging
+    tcb[i].aged         = false;
+    tcb[i].waitTicks    = 0;
+#endif
+#if CONFIG_CPU_BUDGETS
+    tcb[i].budget       = 0;                                                        // Unlimited until setThreadBudget
+    tcb[i].budgetUsed   = 0;
+#endif
+    tcb[i].runTime[0]   = 0;
+    tcb[i].runTime[1]   = 0;
+    tcb[i].switches[0]  = 0;
+    tcb[i].switches[1]  = 0;
+
+    paintStack(tcb[i].stackBase, tcb[i].spInit);                                    // Mark every word as unused
+
+    policy_g->enqueue(i);                                                           // Hand the task to the scheduler
+    taskCount++;                                                                    // Increment record of task count
+    return THREAD_HANDLE(i);
+}
+
+/**
+ *      @brief Create a Thread object with a private heap
+ *              The heap sits above the stack in the same allocation, so it is covered by the thread's MPU settings
+ *      @param fn pointer to the thread to be created
+ *      @param name of the thread to create
+ *      @param priority to be allocated to the thread
+ *      @param stackBytes number of bytes to be allocated to the thread
+ *      @param heapBytes number of bytes to be allocated to the heap of the thread (0 for none)
+ *      @return true status if creation successful
+ *      @return false status if creation unsuccessful (no TCB record, fn already running, no memory,
+ *              a heap too small to hold its control structure, or a heap requested while CONFIG_THREAD_HEAPS is off)
+ **/
+bool createThreadWithHeap(_fn fn, const char name[], uint8_t priority, uint32_t stackBytes, uint32_t heapBytes)
+{
+    uint8_t i = 0;
+    uint32_t totalBytes = stackBytes + heapBytes;
+    uint32_t guardBytes;
+    void *ptr;
+#if CONFIG_THREAD_HEAPS
+    tlsf_t *heap = NULL;
+#endif
+
+    if (taskCount >= MAX_TASKS || isThread(fn))     return false;                   // Prevent re-entrancy
+#if !CONFIG_THREAD_HEAPS
+    if (heapBytes)      return false;                                               // No allocator to manage it
+#endif
+
+    // Find first available TCB record
+    while (tcb[i].state != STATE_INVALID) {i++;}
+
+    ptr = mallocStackFromHeap(totalBytes, &guardBytes);                             // Request memory from heap
+    if (ptr == NULL)    return false;                                               // Leave the record unused
+
+#if CONFIG_THREAD_HEAPS
+    if (heapBytes)
+    {
+        heap = tlsfInit((uint8_t *)ptr + guardBytes + stackBytes, heapBytes);       // Heap above the stack
+        if (heap == NULL)
+        {
+            freeToHeap(ptr);                                                        // Too small for any block
+            return false;
+        }
+    }
+#endif
+
+    setupTcb(i, fn, name, priority, ptr, guardBytes, totalBytes, heapBytes, NULL);
+#if CONFIG_THREAD_HEAPS
+    tcb[i].heap = heap;
+#endif
+    return true;
+}
+
+/**
+ *      @brief Create a Thread object on a caller provided stack
+ *              Nothing is taken from the heap, so creation cannot fail for lack of memory and the thread lands in
+ *              the same TCB record on every boot. Declare the stack with STATIC_STACK so its size and alignment are
+ *              checked at compile time and it lands in the static stack area above the heap, outside the kernel SRAM
+ *              Needs SINGLE_REGION_STACKS, SRD masks can only grant heap subregions
+ *              The whole stack is usable, so there is no guard below it
+ *      @param fn pointer to the thread to be created
+ *      @param name of the thread to create
+ *      @param priority to be allocated to the thread
+ *      @param slot index of the TCB record to use
+ *      @param stack base of the stack, aligned to its size
+ *      @param stackBytes size of the stack, a power of two of at least 32 bytes
+ *      @return true status if creation successful
+ *      @return false status if creation unsuccessful (record in use, fn already running or stack unusable)
+ **/
+bool createThreadStatic(_fn fn, const char name[], uint8_t priority, uint8_t slot, void *stack, uint32_t stackBytes)
+{
+#if SINGLE_REGION_STACKS
+    if (slot >= MAX_TASKS || tcb[slot].state != STATE_INVALID || isThread(fn))     return false;
+    if (stack == NULL || stackBytes < 32 || (stackBytes & (stackBytes - 1)))        return false;   // One MPU region must cover it
+    if ((uint32_t)stack & (stackBytes - 1))                                         return false;
+
+    setupTcb(slot, fn, name, priority, stack, 0, stackBytes, 0, NULL);
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**
+ *      @brief Function to add a thread instance, must be called with privileges
+ *      @param fn pointer to the thread function, called as fn(arg)
+ *      @param arg argument passed to the thread function
+ *      @param name of the thread to create
+ *      @param priority to be allocated to the thread
+ *      @param stackBytes number of bytes to be allocated to the thread
+ *      @return thread_t handle of the thread, 0 if creation was unsuccessful
+ **/
+thread_t addThread(_fn fn, void *arg, const char name[], uint8_t priority, uint32_t stackBytes)
+{
+    uint8_t i = 0;
+    uint32_t guardBytes;
+    void *ptr;
+
+    if (taskCount >= MAX_TASKS)     return 0;
+
+    // Find first available TCB record
+    while (tcb[i].state != STATE_INVALID) {i++;}
+
+    ptr = mallocStackFromHeap(stackBytes, &guardBytes);                             // Request memory from heap
+    if (ptr == NULL)    return 0;
+
+    return setupTcb(i, fn, name, priority, ptr, guardBytes, stackBytes, 0, arg);
+}
+
+/**
+ *      @brief Function to request a new thread from the kernel
+ *      @param request describing the thread, its handle is stored back in it
+ **/
+void requestThread(threadRequest_t *request)
+{
+    __asm(" SVC #0x21");                                    // Trigger a Service call
+}
+
+/**
+ *      @brief Create another instance of a thread function with its own argument
+ *              Unlike createThread the same function may run any number of times, each instance is told apart by its handle
+ *              May be called from threads, the instance releases its TCB record and stack when fn returns or calls threadExit
+ *      @param fn pointer to the thread function, called as fn(arg)
+ *      @param arg argument passed to the thread function
+ *      @param name of the thread to create
+ *      @param priority to be allocated to the thread
+ *      @param stackBytes number of bytes to be allocated to the thread
+ *      @return thread_t handle of the thread, 0 if creation was unsuccessful
+ **/
+thread_t createThreadWithArg(_fn fn, void *arg, const char name[], uint8_t priority, uint32_t stackBytes)
+{
+    threadRequest_t request = {fn, arg, name, priority, stackBytes, 0};
+
+    if (IN_PRIVILEGED_CONTEXT())    return addThread(fn, arg, name, priority, stackBytes);
+
+    requestThread(&request);
+    return request.handle;
+}
+
+/**
+ *      @brief Function to end the current thread
+ *              Its TCB record and stack are released at once and any thread joining it is woken
+ **/
+void threadExit(void)
+{
+    __asm(" SVC #0x1F");                                    // Trigger a Service call
+}
+
+/**
+ *      @brief Function to wait until a thread has exited
+ *              Returns at once if the handle is stale, the thread has already gone
+ *      @param thread handle of the thread to wait for
+ **/
+void threadJoin(thread_t thread)
+{
+    __asm(" SVC #0x20");                                    // Trigger a Service call
+}
+
+/**
+ *      @brief Function a thread returns into, set up as the LR of its first stack frame
+ **/
+void threadReturn(void)
+{
+    threadExit();
+}
+
+#if CONFIG_WORKERS
+/**
+ *      @brief Function to hand queued jobs to the workers waiting for them
+ *              Must be called with privileges, safe from ISRs
+ **/
+void dispatchJobs(void)
+{
+    uint32_t primask = disableInterrupts();                                         // ISRs may submit jobs too
+    uint8_t i;
+
+    for (i = 0; i < MAX_TASKS; i++)
+    {
+        if (tcb[i].state == STATE_BLOCKED_JOB && dequeueJob(tcb[i].jobSlot))    tcb[i].state = STATE_READY;
+    }
+
+    restoreInterrupts(primask);
+}
+#endif
+
+/**
+ *      @brief Function to release the TCB record and memory of a thread that has ended
+ *      @param task index of the TCB record
+ **/
+void releaseThread(uint8_t task)
+{
+    uint8_t i;
+
+    freeToHeap((void *)((uint32_t)tcb[task].stackBase - tcb[task].mpu.guardSize)); // Static stacks are not in the heap and stay put
+
+    for (i = 0; i < MAX_TASKS; i++)                                                 // Wake the threads waiting for this one
+    {
+        if (tcb[i].state == STATE_BLOCKED_JOIN && tcb[i].join == task)  tcb[i].state = STATE_READY;
+    }
+
+    unindexName(task);
+    policy_g->dequeue(task);
+#if CONFIG_PERIODIC_TASKS
+    tcb[task].released = false;                                                     // No job left to miss its deadline
+    tcb[task].missed   = false;
+#endif
+    tcb[task].state = STATE_INVALID;                                                // Record may be reused right away
+    tcb[task].pid   = 0;
+    taskCount--;
 }
 
 /**
@@ -276,72 +1170,315 @@ void startRtos(void)
  **/
 bool createThread(_fn fn, const char name[], uint8_t priority, uint32_t stackBytes)
 {
-    bool ok = false, found = false;
-    uint8_t i = 0;
+    return createThreadWithHeap(fn, name, priority, stackBytes, 0);
+}
+
+#if CONFIG_PERIODIC_TASKS
+/**
+ *      @brief Function to give rate-monotonic priorities to the tasks that asked for them
+ *              Shorter periods get higher priorities, counted down from RM_PRIORITY_BASE
+ *      @param set periodic tasks
+ *      @param count number of tasks in the set
+ **/
+void rankRateMonotonic(rtTask_t set[], uint8_t count)
+{
+    uint8_t i, j, rank;
+
+    for (i = 0; i < count; i++)
+    {
+        if (!set[i].autoPriority)   continue;
+
+        for (j = 0, rank = 0; j < count; j++)                                       // Tasks with a shorter period go first
+        {
+            if (set[j].autoPriority && set[j].periodUs < set[i].periodUs)   rank++;
+        }
+        set[i].priority = (RM_PRIORITY_BASE + rank < NUM_PRIORITIES - 1) ? RM_PRIORITY_BASE + rank : NUM_PRIORITIES - 2;
+    }
+}
+
+/**
+ *      @brief Function to find the worst-case response time of a periodic task by response-time analysis
+ *              Tasks of equal priority count as interference, other (non-periodic) tasks are assumed not to interfere
+ *      @param set periodic tasks
+ *      @param count number of tasks in the set
+ *      @param task position of the task in the set
+ *      @return true if the task always completes within its period
+ **/
+bool meetsDeadline(rtTask_t set[], uint8_t count, uint8_t task)
+{
+    uint64_t response = set[task].wcetUs;
+    uint64_t previous;
+    uint8_t j;
+
+    do
+    {
+        previous = response;
+        response = set[task].wcetUs;
+        for (j = 0; j < count; j++)                                                 // Releases of higher priority tasks within the window
+        {
+            if (j != task && set[j].priority <= set[task].priority)
+            {
+                response += ((previous + set[j].periodUs - 1) / set[j].periodUs) * set[j].wcetUs;
+            }
+        }
+        if (response > set[task].periodUs)     return false;                       // Deadline is the end of the period
+    } while (response != previous);
+
+    return true;
+}
+
+/**
+ *      @brief Function to test whether a set of periodic tasks is schedulable
+ *              A set with only rate-monotonic priorities under the Liu-Layland bound passes at once,
+ *              anything else goes through exact response-time analysis
+ *      @param set periodic tasks
+ *      @param count number of tasks in the set
+ *      @return true if every task meets its deadline
+ **/
+bool isSchedulable(rtTask_t set[], uint8_t count)
+{
+    uint32_t utilisation = 0;                                                       // Per-mille, rounded up
+    bool rateMonotonic = true;
+    uint8_t i;
+
+    for (i = 0; i < count; i++)
+    {
+        utilisation += ((uint64_t)set[i].wcetUs * 1000 + set[i].periodUs - 1) / set[i].periodUs;
+        rateMonotonic &= set[i].autoPriority;
+    }
+
+    if (utilisation > 1000)     return false;                                       // Overloaded whatever the priorities
+    if (rateMonotonic && utilisation <= ((count <= 10) ? liuLayland_g[count - 1] : LIU_LAYLAND_LIMIT))     return true;
+
+    for (i = 0; i < count; i++)
+    {
+        if (!meetsDeadline(set, count, i))  return false;
+    }
+    return true;
+}
+
+/**
+ *      @brief Create a periodic Thread object after checking that the task set stays schedulable
+ *              The periodic tasks already created and the new one are checked together, with priorities
+ *              assigned rate-monotonically to every task created with RM_PRIORITY
+ *              Called from main before startRtos, like createThread
+ *      @param fn pointer to the thread to be created
+ *      @param name of the thread to create
+ *      @param priority to be allocated to the thread, RM_PRIORITY to derive it from the period
+ *      @param stackBytes number of bytes to be allocated to the thread
+ *      @param periodMs release period of the thread (deadline at the end of the period)
+ *      @param wcetUs worst-case execution time of one release
+ *      @return true status if creation successful
+ *      @return false status if creation unsuccessful, or the task set would miss deadlines and ADMISSION_REJECT is set
+ **/
+bool createPeriodicThread(_fn fn, const char name[], uint8_t priority, uint32_t stackBytes, uint32_t periodMs, uint32_t wcetUs)
+{
+    rtTask_t set[MAX_TASKS];
+    uint8_t task[MAX_TASKS];
+    uint8_t count = 0;
+    uint8_t i;
+
+    if (!periodMs || periodMs > MAX_PERIOD_MS || !wcetUs || wcetUs > periodMs * 1000)  return false;
+    if (taskCount >= MAX_TASKS)                                                     return false;   // No record for the candidate
+
+    for (i = 0; i < MAX_TASKS; i++)                                                 // Periodic tasks already admitted
+    {
+        if (tcb[i].state == STATE_INVALID || !tcb[i].periodUs)  continue;
+
+        set[count].periodUs     = tcb[i].periodUs;
+        set[count].wcetUs       = tcb[i].wcetUs;
+        set[count].priority     = tcb[i].priority;
+        set[count].autoPriority = tcb[i].autoPriority;
+        task[count++] = i;
+    }
+
+    set[count].periodUs     = periodMs * 1000;                                      // The candidate goes last
+    set[count].wcetUs       = wcetUs;
+    set[count].priority     = (priority < NUM_PRIORITIES) ? priority : NUM_PRIORITIES - 1;
+    set[count].autoPriority = (priority == RM_PRIORITY);
+    count++;
+
+    rankRateMonotonic(set, count);
+    if (!isSchedulable(set, count))
+    {
+        if (ADMISSION_REJECT)   return false;
+        putsUart0("Admission: periodic task set may miss deadlines\r\n");        // Admit it anyway and say so
+    }
+
+    if (!createThread(fn, name, set[count - 1].priority, stackBytes))   return false;
+
+    task[count - 1] = findThread((uint32_t)fn);
+    for (i = 0; i < count; i++)                                                     // Apply the periods and any new ranks
+    {
+        tcb[task[i]].periodUs       = set[i].periodUs;
+        tcb[task[i]].wcetUs         = set[i].wcetUs;
+        tcb[task[i]].autoPriority   = set[i].autoPriority;
+        if (tcb[task[i]].threshold == tcb[task[i]].priority || tcb[task[i]].threshold > set[i].priority)
+        {
+            tcb[task[i]].threshold  = set[i].priority;                              // Keep a raised threshold, never a lowered one
+        }
+        tcb[task[i]].priority       = set[i].priority;
+        tcb[task[i]].currentPriority = set[i].priority;
+        END_AGING(task[i]);
+    }
+    return true;
+}
+#endif
+
+/**
+ *      @brief Function to restart a thread
+ *      @param fn pointer to the function to be restarted, or its thread handle cast to _fn
+ **/
+void restartThread(_fn fn)
+{
+    __asm(" SVC #0x07");                                    // Trigger a Service call
+}
+
+/**
+*      @brief Function to stop a thread
+*      @param fn to be stopped, or its thread handle cast to _fn
+**/
+void stopThread(_fn fn)
+{
+    __asm(" SVC #0x06");                                    // Trigger a Service call
+}
+
+/**
+*      @brief Function to set the Thread Priority
+*      @param fn pointer to the thread to be updated, or its thread handle cast to _fn
+*      @param priority to be set for the thread
+**/
+void setThreadPriority(_fn fn, uint8_t priority)
+{
+    __asm(" SVC #0x17");                                    // Trigger a Service call
+}
+
+/**
+*      @brief Function to set the time slice of a priority level
+*      @param priority level to be updated
+*      @param ticks the running task keeps the CPU before an equal priority task gets it (at least 1)
+**/
+void setTimeSlice(uint8_t priority, uint16_t ticks)
+{
+    __asm(" SVC #0x24");                                    // Trigger a Service call
+}
 
-    if (taskCount < MAX_TASKS)
-    {
-        // Ensure "fn" not already in list (prevent re-entrancy)
-        while (!found && (i < MAX_TASKS))
-        {
-            found = (tcb[i++].pid ==  fn);
-        }
+/**
+*      @brief Function to set the preemption threshold of a thread
+*              While the thread runs, only tasks of higher priority than the threshold may preempt it, and its time slice
+*              does not expire. Tasks sharing a threshold run to completion with respect to each other
+*      @param fn pointer to the thread to be updated, or its thread handle cast to _fn
+*      @param threshold priority level, the thread's own priority turns the threshold off
+**/
+void setThreadThreshold(_fn fn, uint8_t threshold)
+{
+    __asm(" SVC #0x25");                                    // Trigger a Service call
+}
 
-        if (!found)
-        {
-            // Find first available TCB record
-            i = 0;
-            while (tcb[i].state != STATE_INVALID) {i++;}
+#if CONFIG_CPU_BUDGETS
+/**
+*      @brief Function to limit the CPU time of a thread in every budget period (BUDGET_PERIOD ticks)
+*              A thread that uses up its budget is suspended or demoted to the lowest priority until the next period,
+*              even with preemption off, so a runaway thread cannot hold the CPU
+*      @param fn pointer to the thread to be updated, or its thread handle cast to _fn
+*      @param budgetUs microseconds of CPU time per period, 0 for unlimited
+*      @param suspend true to suspend the thread once the budget is used, false to demote it
+*              (a demoted thread only gives the CPU back to others when preemption is on)
+**/
+void setThreadBudget(_fn fn, uint32_t budgetUs, bool suspend)
+{
+    __asm(" SVC #0x26");                                    // Trigger a Service call
+}
+#endif
 
-            // An empty record has been found
-            void *ptr = mallocFromHeap(stackBytes);                         // Request memory from heap
+#if CONFIG_PRIORITY_AGING
+/**
+*      @brief Function to turn priority aging of a thread on or off
+*              While the thread is ready but not running, its priority rises one level every AGING_INTERVAL ticks,
+*              up to AGING_LIMIT, and drops back to its own priority once it runs, so it cannot be starved
+*      @param fn pointer to the thread to be updated, or its thread handle cast to _fn
+*      @param on true to age the thread
+**/
+void setThreadAging(_fn fn, bool on)
+{
+    __asm(" SVC #0x27");                                    // Trigger a Service call
+}
+#endif
 
-            strcpy(tcb[i].name, name);                                      // Store name
-            tcb[i].state        = STATE_UNRUN;                              // Store initial state as Un-Run
-            tcb[i].pid          = fn;                                       // Store PID
-            tcb[i].sp           = (void *)((uint32_t)ptr + stackBytes);     // ptr + (size in hex)
-            tcb[i].spInit       = (void *)((uint32_t)ptr + stackBytes);     // ptr + (size in hex)
-            tcb[i].priority     = priority;                                 // Store the requested PID
-            tcb[i].currentPriority  = priority;                             // Store the requested PID
-            tcb[i].runTime[0]   = 0;
-            tcb[i].runTime[1]   = 0;
+#if CONFIG_STRIDE_SCHEDULER
+/**
+*      @brief Function to set the CPU share of a thread under the stride scheduler
+*              Ready threads get the CPU in proportion to their tickets
+*      @param fn pointer to the thread to be updated, or its thread handle cast to _fn
+*      @param tickets weight of the thread, 1 to STRIDE_ONE
+**/
+void setThreadTickets(_fn fn, uint16_t tickets)
+{
+    __asm(" SVC #0x28");                                    // Trigger a Service call
+}
+#endif
 
-            generateSrdMasks(ptr, stackBytes, tcb[i].srd);                  // Store SRD masks in the TCB
+#if CONFIG_THREAD_HEAPS
+/**
+*      @brief Function to get the private heap of the current thread
+*      @param heap location to store the heap control structure
+**/
+void getThreadHeap(tlsf_t **heap)
+{
+    __asm(" SVC #0x1C");                                    // Trigger a Service call
+}
 
-            taskCount++;                                                    // Increment record of task count
-            ok = true;
-        }
-    }
-    return ok;
+/**
+*      @brief Function to allocate memory from the private heap of the current thread
+*              Runs unprivileged in memory the thread already owns, so it cannot touch other threads
+*      @param size requested in bytes
+*      @return void* address of the allocated memory, NULL if none is available
+**/
+void *threadMalloc(uint32_t size)
+{
+    tlsf_t *heap = NULL;
+    getThreadHeap(&heap);
+    return tlsfMalloc(heap, size);
 }
 
 /**
- *      @brief Function to restart a thread
- *      @param fn pointer to the function to be restarted
- **/
-void restartThread(_fn fn)
+*      @brief Function to release memory to the private heap of the current thread
+*      @param ptr address returned by threadMalloc
+**/
+void threadFree(void *ptr)
 {
-    __asm(" SVC #0x07");                                    // Trigger a Service call
+    tlsf_t *heap = NULL;
+    getThreadHeap(&heap);
+    tlsfFree(heap, ptr);
 }
+#endif
 
+#if CONFIG_SHARED_MEMORY
 /**
-*      @brief Function to stop a thread
-*      @param fn to be stopped
+*      @brief Function to request a shared memory window for the current thread
+*      @param name of the shared memory object
+*      @param writable true for read-write access, false for read-only
+*      @param address location to store the address of the object
 **/
-void stopThread(_fn fn)
+void requestWindow(const char name[], bool writable, void **address)
 {
-    __asm(" SVC #0x06");                                    // Trigger a Service call
+    __asm(" SVC #0x1D");                                    // Trigger a Service call
 }
 
 /**
-*      @brief Function to set the Thread Priority
-*      @param fn pointer to the thread to be updated
-*      @param priority to be set for the thread
+*      @brief Function to map a shared memory object into the current thread
+*              The object gets its own MPU region, so only threads that attached to it can reach it
+*      @param name of the shared memory object created with createSharedMemory
+*      @param writable true for read-write access, false for read-only
+*      @return void* address of the object, NULL if it does not exist or no window is free
 **/
-void setThreadPriority(_fn fn, uint8_t priority)
+void *attachSharedMemory(const char name[], bool writable)
 {
-    __asm(" SVC #0x17");                                    // Trigger a Service call
+    void *address = NULL;
+    requestWindow(name, writable, &address);
+    return address;
 }
+#endif
 
 /**
  *      @brief Function to yield execution back to scheduler using pendSv
@@ -396,13 +1533,56 @@ void post(int8_t semaphore)
     __asm(" SVC #0x05");                                    // Trigger a Service call
 }
 
+#if CONFIG_PERIODIC_TASKS
+/**
+ *      @brief Function to start timing a job of a periodic task when it becomes ready again
+ *      @param task index of the TCB record
+ **/
+void releaseJob(uint8_t task)
+{
+    if (!tcb[task].periodUs || tcb[task].released)     return;
+
+    tcb[task].released = true;
+    tcb[task].missed = false;
+    tcb[task].releaseTime = KERNEL_TIME();
+    tcb[task].jobCounts = (task == taskCurrent) ? 0 - WTIMER0_TAV_R : 0;           // The running task is charged only from here on
+}
+
+/**
+ *      @brief Function to record the timing of a job when the running periodic task sleeps or waits
+ *              The first job has no release time and is not counted
+ **/
+void completeJob(void)
+{
+    uint32_t response, execution;
+
+    if (!tcb[taskCurrent].released)     return;
+
+    response = KERNEL_TIME() - tcb[taskCurrent].releaseTime;
+    execution = tcb[taskCurrent].jobCounts + WTIMER0_TAV_R;                         // Slices charged so far and the one running
+
+    tcb[taskCurrent].released = false;
+    tcb[taskCurrent].jobs++;
+    tcb[taskCurrent].responseSum += response;
+    if (execution > tcb[taskCurrent].execMax)       tcb[taskCurrent].execMax = execution;
+    if (response < tcb[taskCurrent].responseMin)    tcb[taskCurrent].responseMin = response;
+    if (response > tcb[taskCurrent].responseMax)    tcb[taskCurrent].responseMax = response;
+    if (!tcb[taskCurrent].missed && response > tcb[taskCurrent].periodUs * TIMER_COUNTS_PER_US)
+    {
+        tcb[taskCurrent].misses++;                                                  // Finished past a deadline systick did not see yet
+    }
+}
+#endif
+
 /**
 *      @brief Function to decrement the tick count every 1ms
 **/
 void systickIsr(void)
 {
     uint8_t i;
-    for (i = 0; i < taskCount; i++)
+    bool woken = false;
+
+    for (i = 0; i < MAX_TASKS; i++)                         // Records are reused, so valid tasks need not be packed at the front
     {
         if (tcb[i].state == STATE_DELAYED)                  // Decrement tick for threads marked "DELAYED"
         {
@@ -410,11 +1590,75 @@ void systickIsr(void)
             if (tcb[i].ticks == 0)                          // Update state to ready if ticks run out
             {
                 tcb[i].state = STATE_READY;
+                woken = true;
+                TRACE(TRACE_WAKE, i, 0);
+#if CONFIG_PERIODIC_TASKS
+                releaseJob(i);                              // Start of the next period
+#endif
+            }
+        }
+
+#if CONFIG_PERIODIC_TASKS
+        // Count a miss as soon as the deadline passes, a job that never completes is still caught
+        if (tcb[i].state != STATE_INVALID && tcb[i].released && !tcb[i].missed
+            && KERNEL_TIME() - tcb[i].releaseTime > tcb[i].periodUs * TIMER_COUNTS_PER_US)
+        {
+            tcb[i].missed = true;
+            tcb[i].misses++;
+            TRACE(TRACE_MISS, i, tcb[i].misses);
+        }
+#endif
+
+#if CONFIG_PRIORITY_AGING
+        // Raise a task that has waited to run for AGING_INTERVAL ticks by one level
+        if (tcb[i].aging && (tcb[i].state == STATE_READY || tcb[i].state == STATE_UNRUN) && i != taskCurrent
+            && !tcb[i].throttled && ++tcb[i].waitTicks >= AGING_INTERVAL)
+        {
+            tcb[i].waitTicks = 0;
+            if (tcb[i].currentPriority > AGING_LIMIT)
+            {
+                if (!tcb[i].aged)   tcb[i].agedFrom = tcb[i].currentPriority;
+                tcb[i].currentPriority--;
+                tcb[i].aged = true;
+                woken = true;                               // May now outrank the running task
+            }
+        }
+#endif
+    }
+
+    if (policy_g->tick())   woken = true;                   // Slice used up
+
+#if CONFIG_CPU_BUDGETS
+    if (!--budgetPeriodLeft_g)                              // Start a new budget period
+    {
+        budgetPeriodLeft_g = BUDGET_PERIOD;
+        for (i = 0; i < MAX_TASKS; i++)
+        {
+            tcb[i].budgetUsed = 0;
+            if (tcb[i].throttled)                           // Undo the suspension or demotion
+            {
+                tcb[i].throttled = false;
+                if (tcb[i].state == STATE_THROTTLED)    tcb[i].state = STATE_READY;
+                else if (!tcb[i].budgetSuspend)         tcb[i].currentPriority = tcb[i].priority;
+                woken = true;
             }
         }
     }
 
-    if (preemption)     enablePendSV();
+    // Switch out a task that overran its budget, with or without preemption
+    if (tcb[taskCurrent].budget && !tcb[taskCurrent].throttled
+        && tcb[taskCurrent].budgetUsed + WTIMER0_TAV_R >= tcb[taskCurrent].budget)
+    {
+        enablePendSV();
+    }
+#endif
+
+    // Reschedule only when the slice is used up or a woken task may outrank the running one
+    if (preemption && woken)
+    {
+        TRACE(TRACE_PREEMPT, taskCurrent, 0);
+        enablePendSV();
+    }
 
     if (twoSecondLoad_g)
     {
@@ -424,14 +1668,41 @@ void systickIsr(void)
     if (!twoSecondLoad_g)                              // One second has elapsed
     {
         twoSecondLoad_g = 2000;                             // Reload the value
-        for (i = 0; i < taskCount; i++)
+        for (i = 0; i < MAX_TASKS; i++)
         {
             tcb[i].runTime[!activeFillIndex_g] = 0;         // Zero out the values before accumulating new ones
+            tcb[i].switches[!activeFillIndex_g] = 0;
         }
         activeFillIndex_g = !activeFillIndex_g;             // Start saving time in the other index
     }
 }
 
+#if CONFIG_CPU_BUDGETS
+/**
+ *      @brief Function to charge the task being switched out and throttle it once its budget is used up
+ *      @param task index of the TCB record
+ *      @param counts timer counts the task ran for since it was switched in
+ **/
+void chargeBudget(uint8_t task, uint32_t counts)
+{
+    tcb[task].budgetUsed += counts;
+
+    if (!tcb[task].budget || tcb[task].throttled || tcb[task].budgetUsed < tcb[task].budget)  return;
+
+    tcb[task].throttled = true;
+    if (tcb[task].budgetSuspend)
+    {
+        if (tcb[task].state == STATE_READY)     tcb[task].state = STATE_THROTTLED;  // Blocked tasks are suspended by rtosScheduler once woken
+    }
+    else
+    {
+        tcb[task].currentPriority = NUM_PRIORITIES - 1;                             // Only runs when nothing else is ready
+        END_AGING(task);
+    }
+    if (task == taskCurrent)    sliceLeft_g = 0;                                    // Give up the CPU now
+}
+#endif
+
 /**
  *      @brief Function to handle context switching
  *              This is essentially an ISR and will be called automatically and performs the following:
@@ -449,6 +1720,22 @@ __attribute__((naked)) void pendSvIsr(void)
 
     tcb[taskCurrent].sp = (void *)getPSP();                 // Store the PSP to the sp of the current task
     tcb[taskCurrent].runTime[activeFillIndex_g] += WTIMER0_TAV_R;
+#if CONFIG_CPU_BUDGETS
+    chargeBudget(taskCurrent, WTIMER0_TAV_R);               // Throttle the task if it used up its budget
+#endif
+    if (policy_g->charge && tcb[taskCurrent].state != STATE_INVALID)
+    {
+        policy_g->charge(taskCurrent, WTIMER0_TAV_R);       // Charge the policy (exited tasks have left its queue)
+    }
+#if CONFIG_PERIODIC_TASKS || CONFIG_TRACE
+    kernelTime_g += WTIMER0_TAV_R;                          // Advance the time base shared by every task
+#endif
+#if CONFIG_PERIODIC_TASKS
+    if (tcb[taskCurrent].released)  tcb[taskCurrent].jobCounts += WTIMER0_TAV_R;
+#endif
+#if CONFIG_TRACE
+    switchedOut_g = taskCurrent;
+#endif
 
     // Check if PendSV was invoked because of an MPU fault
     if ((getFaultFlags() && NVIC_FAULT_STAT_IERR) || (getFaultFlags() && NVIC_FAULT_STAT_DERR))
@@ -457,9 +1744,10 @@ __attribute__((naked)) void pendSvIsr(void)
     }
 
     rtosScheduler();                                        // Invoke RTOS scheduler, get next task
+    TRACE(TRACE_SWITCH, taskCurrent, (switchedOut_g << 8) | tcb[switchedOut_g].state);
 
     pidExtern_g = (uint32_t)tcb[taskCurrent].pid;
-    applySrdRules(tcb[taskCurrent].srd);                    // Apply the SRD rules specific to the first thread
+    applyTaskMpu(&tcb[taskCurrent].mpu);                    // Apply the MPU rules specific to the next thread
     loadPSP((uint32_t)tcb[taskCurrent].sp);                 // Load the new PSP and execute
 
     switch (tcb[taskCurrent].state)
@@ -472,12 +1760,12 @@ __attribute__((naked)) void pendSvIsr(void)
             uint32_t *psp = (uint32_t *)tcb[taskCurrent].sp; // Get the stack pointer
             *(psp - 1) = 0x01000000;                        // Load the Thumb bit in the xPSR or things go south
             *(psp - 2) = (uint32_t)tcb[taskCurrent].pid;    // Store PC
-            *(psp - 3) = 0xFFFFFFFD;                        // Store LR
+            *(psp - 3) = (uint32_t)threadReturn;            // Store LR, a returning thread exits
             *(psp - 4) = 0xFFFFFFFF;                        // Store R12
             *(psp - 5) = 0xFFFFFFFF;                        // Store R3
             *(psp - 6) = 0xFFFFFFFF;                        // Store R2
             *(psp - 7) = 0xFFFFFFFF;                        // Store R1
-            *(psp - 8) = 0xFFFFFFFF;                        // Store R0
+            *(psp - 8) = (uint32_t)tcb[taskCurrent].arg;    // Store R0 (argument of the thread)
 
             psp = psp - 0x08;                               // Update the PSP pointer to drop down 8 locations to POP
 
@@ -521,10 +1809,13 @@ void svCallIsr(void)
     bool exists = false;
     uint32_t svcAction = getSvcPriority();                                                  // Get the action value from the SVC request
 
+    TRACE(TRACE_SVC, taskCurrent, svcAction);
+
     switch (svcAction)                                                                      // Check the action value to determine the action to take
     {
         case YIELD:
         {
+            policy_g->yield();                                                              // Give up the rest of the slice
             enablePendSV();
             break;
         }
@@ -533,6 +1824,9 @@ void svCallIsr(void)
         {
             tcb[taskCurrent].state = STATE_DELAYED;                                         // Set state to Delayed in the Task Control Block
             tcb[taskCurrent].ticks = getArgs();                                             // Get the Ticks from R0
+#if CONFIG_PERIODIC_TASKS
+            completeJob();                                                                  // Job done until the sleep ends
+#endif
 
             enablePendSV();                                                                 // Enable PendSV to perform a context switch
 
@@ -554,6 +1848,7 @@ void svCallIsr(void)
             {
                 // Elevate priority of the task holding the resource to that of one requesting it
                 tcb[CURRENT_MUTEX.lockedBy].currentPriority = tcb[taskCurrent].currentPriority;
+                END_AGING(CURRENT_MUTEX.lockedBy);
             }
 
             // Priority inheritance is disabled. Add process to queue
@@ -574,16 +1869,16 @@ void svCallIsr(void)
 
             if (CURRENT_MUTEX.lockedBy == taskCurrent)
             {
-                if (CURRENT_MUTEX.queueSize)                                                // Can have a max of 2 tasks in the queue
+                if (CURRENT_MUTEX.queueSize)                                                // Can have a max of MAX_MUTEX_QUEUE_SIZE tasks in the queue
                 {
                     tcb[CURRENT_MUTEX.processQueue[0]].state = STATE_READY;                 // Ready the oldest waiting task to ready
                     CURRENT_MUTEX.lockedBy = CURRENT_MUTEX.processQueue[0];                 // Update the ID of the task locking the resource
 
-                    if (CURRENT_MUTEX.queueSize == 2)                                       // Can have a max of 2 tasks in the queue
+                    CURRENT_MUTEX.queueSize--;                                              // Decrement count of waiting processes
+                    for (i = 0; i < CURRENT_MUTEX.queueSize; i++)
                     {
-                        CURRENT_MUTEX.processQueue[0] = CURRENT_MUTEX.processQueue[1];      // Shift the queue up
+                        CURRENT_MUTEX.processQueue[i] = CURRENT_MUTEX.processQueue[i + 1];  // Shift the queue up
                     }
-                    CURRENT_MUTEX.queueSize--;                                              // Decrement count of waiting processes
                 }
 
                 else
@@ -595,6 +1890,7 @@ void svCallIsr(void)
                 if (priorityInheritance && tcb[CURRENT_MUTEX.lockedBy].currentPriority != tcb[CURRENT_MUTEX.lockedBy].priority)
                 {
                     tcb[CURRENT_MUTEX.lockedBy].currentPriority = tcb[CURRENT_MUTEX.lockedBy].priority;
+                    END_AGING(CURRENT_MUTEX.lockedBy);
                 }
                 enablePendSV();                                                             // Enable PendSV to perform a context switch
             }
@@ -604,10 +1900,16 @@ void svCallIsr(void)
         case WAIT:
         {
             tcb[taskCurrent].semaphore = (uint8_t)getArgs();                                // Get semaphore value
+#if CONFIG_PERIODIC_TASKS
+            completeJob();                                                                  // Job done, the next one starts when the wait ends
+#endif
 
             if (CURRENT_SEMAPHORE.count >= 1)                                               // If semaphore value is greater than zero, decrements
             {
                 CURRENT_SEMAPHORE.count--;
+#if CONFIG_PERIODIC_TASKS
+                releaseJob(taskCurrent);                                                    // Released straight away
+#endif
             }
 
             else if (CURRENT_SEMAPHORE.queueSize < MAX_SEMAPHORE_QUEUE_SIZE)
@@ -639,11 +1941,14 @@ void svCallIsr(void)
             if (CURRENT_SEMAPHORE.queueSize)                                                // Someone is waiting the queue
             {
                 tcb[CURRENT_SEMAPHORE.processQueue[0]].state = STATE_READY;                 // Update state
+#if CONFIG_PERIODIC_TASKS
+                releaseJob(CURRENT_SEMAPHORE.processQueue[0]);                              // Event driven release
+#endif
 
-                if (CURRENT_SEMAPHORE.queueSize == 2)
+                CURRENT_SEMAPHORE.queueSize--;                                              // Update queue size
+                for (i = 0; i < CURRENT_SEMAPHORE.queueSize; i++)
                 {
-                    CURRENT_SEMAPHORE.processQueue[0] = CURRENT_SEMAPHORE.processQueue[1];  // Shift up the queue
-                    CURRENT_SEMAPHORE.queueSize--;                                          // Update queue size
+                    CURRENT_SEMAPHORE.processQueue[i] = CURRENT_SEMAPHORE.processQueue[i + 1];  // Shift up the queue
                 }
             }
 
@@ -661,52 +1966,48 @@ void svCallIsr(void)
         {
             uint32_t pidToStop = (uint32_t)getArgs();                                       // Get the task to be stopped
 
-            for (i = 0; i < MAX_TASKS; i++)
+            i = findThread(pidToStop);                                                      // Handle or function address
+            if (i < MAX_TASKS)
             {
-                if ((uint32_t)tcb[i].pid == pidToStop)
+                // Remove task from Mutex queue
+                if (tcb[i].state == STATE_BLOCKED_MUTEX)                                    // Task is waiting the queue
                 {
-                    // Remove task from Mutex queue
-                    if (tcb[i].state == STATE_BLOCKED_MUTEX)                                // Task is waiting the queue
+                    for (j = 0; j < mutexes[tcb[i].mutex].queueSize; j++)
                     {
-                        for (j = 0; j < mutexes[tcb[i].mutex].queueSize; j++)
+                        if (mutexes[tcb[i].mutex].processQueue[j] == i)                     // Find task
                         {
-                            if (mutexes[tcb[i].mutex].processQueue[j] == i)                 // Find task
+                            if ((i + 1) < mutexes[tcb[i].mutex].queueSize)                  // Move lower task to current tasks position
                             {
-                                if ((i + 1) < mutexes[tcb[i].mutex].queueSize)              // Move lower task to current tasks position
-                                {
-                                    mutexes[tcb[i].mutex].processQueue[j] = mutexes[tcb[i].mutex].processQueue[j + 1];
-                                    mutexes[tcb[i].mutex].queueSize--;                      // Decrement queue size
-                                }
-                                else mutexes[tcb[i].mutex].queueSize--;                     // Decrement queue size
+                                mutexes[tcb[i].mutex].processQueue[j] = mutexes[tcb[i].mutex].processQueue[j + 1];
+                                mutexes[tcb[i].mutex].queueSize--;                          // Decrement queue size
                             }
+                            else mutexes[tcb[i].mutex].queueSize--;                         // Decrement queue size
                         }
                     }
+                }
 
-                    // Remove task from Semaphore queue
-                    if (tcb[i].state == STATE_BLOCKED_SEMAPHORE)                            // Task is waiting the queue
+                // Remove task from Semaphore queue
+                if (tcb[i].state == STATE_BLOCKED_SEMAPHORE)                                // Task is waiting the queue
+                {
+                    for (j = 0; j < semaphores[tcb[i].semaphore].queueSize; j++)
                     {
-                        for (j = 0; j < semaphores[tcb[i].semaphore].queueSize; j++)
+                        // Find task
+                        if (semaphores[tcb[i].semaphore].processQueue[j] == i)
                         {
-                            // Find task
-                            if (semaphores[tcb[i].semaphore].processQueue[j] == i)
+                            if ((i + 1) < semaphores[tcb[i].semaphore].queueSize)           // Move lower task to current tasks position
                             {
-                                if ((i + 1) < semaphores[tcb[i].semaphore].queueSize)       // Move lower task to current tasks position
-                                {
-                                    semaphores[tcb[i].semaphore].processQueue[j] = semaphores[tcb[i].semaphore].processQueue[j + 1];
-                                    semaphores[tcb[i].semaphore].queueSize--;               // Decrement queue size
-                                }
-                                else semaphores[tcb[i].semaphore].queueSize--;              // Decrement queue size
+                                semaphores[tcb[i].semaphore].processQueue[j] = semaphores[tcb[i].semaphore].processQueue[j + 1];
+                                semaphores[tcb[i].semaphore].queueSize--;                   // Decrement queue size
                             }
+                            else semaphores[tcb[i].semaphore].queueSize--;                  // Decrement queue size
                         }
                     }
-
-                    tcb[i].mutex      = 0;                                                  // Clear values from the TCB
-                    tcb[i].semaphore  = 0;                                                  // Clear values from the TCB
-                    tcb[i].ticks      = 0;                                                  // Clear values from the TCB
-                    tcb[i].state      = STATE_STOPPED;                                      // Mark the state of the thread as stopped
-
-                    break;                                                                  // Break out of the loop
                 }
+
+                tcb[i].mutex      = 0;                                                      // Clear values from the TCB
+                tcb[i].semaphore  = 0;                                                      // Clear values from the TCB
+                tcb[i].ticks      = 0;                                                      // Clear values from the TCB
+                tcb[i].state      = STATE_STOPPED;                                          // Mark the state of the thread as stopped
             }
 
             print((void *)&pidToStop, "Stopped", INT);
@@ -718,14 +2019,8 @@ void svCallIsr(void)
         {
             uint32_t pidToStart = (uint32_t)getArgs();                                      // Get the task to be restarted
 
-            for (i = 0; i < MAX_TASKS; i++)                                                 // Iterate over all tasks
-            {
-                if ((uint32_t)tcb[i].pid == pidToStart)                                     // Find the task to be started
-                {
-                    tcb[i].state = STATE_READY;                                             // Update the state to ready
-                    break;
-                }
-            }
+            i = findThread(pidToStart);                                                     // Handle or function address
+            if (i < MAX_TASKS)  tcb[i].state = STATE_READY;                                 // Update the state to ready
             print((void *)&pidToStart, "Restarted", INT);
             enablePendSV();                                                                 // Enable PendSV
             break;
@@ -744,16 +2039,34 @@ void svCallIsr(void)
 
             uint32_t sum = 0;
             uint32_t cpuTime = 0;
+#if CONFIG_STRIDE_SCHEDULER
+            uint32_t tickets = 0;
+
+            for (i = 0; i < MAX_TASKS; i++)                                                 // Tickets of the tasks competing for the CPU
+            {
+                if (tcb[i].state != STATE_INVALID && tcb[i].currentPriority != NUM_PRIORITIES - 1)  tickets += tcb[i].tickets;
+            }
+#endif
             for (i = 0; i < MAX_TASKS; i++)
             {
                 psInfo[i].task = i;
-                psInfo[i].pid = (uint32_t)tcb[i].pid;
+                psInfo[i].pid = tcb[i].pid ? THREAD_HANDLE(i) : 0;                          // Unique for every instance
 
                 sum += (tcb[i].runTime[!activeFillIndex_g]);
                 cpuTime = (tcb[i].runTime[!activeFillIndex_g]);
                 cpuTime = (cpuTime / 8000);
 
                 psInfo[i].cpuTime = cpuTime;
+                psInfo[i].switches = tcb[i].switches[!activeFillIndex_g];
+                psInfo[i].targetShare = 0;                                                  // Only the stride scheduler has a target
+#if CONFIG_STRIDE_SCHEDULER
+                if (policy_g == &stridePolicy_g && tcb[i].state != STATE_INVALID && tcb[i].currentPriority != NUM_PRIORITIES - 1)
+                {
+                    psInfo[i].targetShare = (tcb[i].tickets * 10000) / tickets;             // Same 0.01% units as cpuTime
+                }
+#endif
+                psInfo[i].stackSize = (uint32_t)tcb[i].spInit - (uint32_t)tcb[i].stackBase;
+                psInfo[i].stackUsed = tcb[i].pid ? getStackUsed(i) : 0;               // Scan only when asked
                 strcpy(psInfo[i].name, tcb[i].name);
             }
 
@@ -767,9 +2080,14 @@ void svCallIsr(void)
 
         case SCHED:
         {
-            priorityScheduler = getArgs();
-            if (priorityScheduler)      putsUart0("Scheduler Mode: Priority\r\n");
-            else                        putsUart0("Scheduler Mode: Round-Robin\r\n");
+            const char *name = (const char *)getArgs();                                     // Get the policy name
+
+            for (i = 0; i < NUM_POLICIES && strcmp(policies_g[i]->name, name); i++);
+            if (i < NUM_POLICIES && policies_g[i] != policy_g)  setPolicy(policies_g[i]);
+
+            putsUart0("Scheduler Mode: ");
+            putsUart0((char *)policy_g->name);
+            putsUart0("\r\n");
 
             enablePendSV();
 
@@ -779,7 +2097,7 @@ void svCallIsr(void)
         case PREEMPT:
         {
             preemption = getArgs();
-            if (priorityScheduler)      putsUart0("Preemption Mode: On\r\n");
+            if (preemption)             putsUart0("Preemption Mode: On\r\n");
             else                        putsUart0("Preemption Mode: Off\r\n");
 
             enablePendSV();
@@ -793,14 +2111,8 @@ void svCallIsr(void)
             uint32_t *psp = (uint32_t *)getPSP();
             uint32_t *pid = (uint32_t *)*(psp + 1);
 
-            for (i = 0; i < MAX_TASKS; i++)
-            {
-                if (!(strcmp(tcb[i].name, functionName)))
-                {
-                    *pid = (uint32_t) tcb[i].pid;
-                    break;
-                }
-            }
+            i = findThreadByName(functionName, MAX_TASKS);
+            if (i < MAX_TASKS)  *pid = THREAD_HANDLE(i);
             break;
         }
 
@@ -808,52 +2120,48 @@ void svCallIsr(void)
         {
             char *funcToStop = (char *)getArgs();                                           // Get the task to be stopped
 
-            for (i = 0; i < MAX_TASKS; i++)                                                 // Iterate over all tasks
+            i = findThreadByName(funcToStop, MAX_TASKS);                                    // Look the name up in the index
+            if (i < MAX_TASKS)
             {
-                if (!(strcmp(tcb[i].name, funcToStop)))                                     // Match the function name in the TCB
+                // Remove task from Mutex queue
+                if (tcb[i].state == STATE_BLOCKED_MUTEX)                                    // Task is waiting the queue
                 {
-                    // Remove task from Mutex queue
-                    if (tcb[i].state == STATE_BLOCKED_MUTEX)                                // Task is waiting the queue
+                    for (j = 0; j < mutexes[tcb[i].mutex].queueSize; j++)
                     {
-                        for (j = 0; j < mutexes[tcb[i].mutex].queueSize; j++)
+                        if (mutexes[tcb[i].mutex].processQueue[j] == i)                     // Find task
                         {
-                            if (mutexes[tcb[i].mutex].processQueue[j] == i)                 // Find task
+                            if ((i + 1) < mutexes[tcb[i].mutex].queueSize)                  // Move lower task to current tasks position
                             {
-                                if ((i + 1) < mutexes[tcb[i].mutex].queueSize)              // Move lower task to current tasks position
-                                {
-                                    mutexes[tcb[i].mutex].processQueue[j] = mutexes[tcb[i].mutex].processQueue[j + 1];
-                                    mutexes[tcb[i].mutex].queueSize--;                      // Decrement queue size
-                                }
-                                else mutexes[tcb[i].mutex].queueSize--;                     // Decrement queue size
+                                mutexes[tcb[i].mutex].processQueue[j] = mutexes[tcb[i].mutex].processQueue[j + 1];
+                                mutexes[tcb[i].mutex].queueSize--;                          // Decrement queue size
                             }
+                            else mutexes[tcb[i].mutex].queueSize--;                         // Decrement queue size
                         }
                     }
+                }
 
-                    // Remove task from Semaphore queue
-                    if (tcb[i].state == STATE_BLOCKED_SEMAPHORE)                            // Task is waiting the queue
+                // Remove task from Semaphore queue
+                if (tcb[i].state == STATE_BLOCKED_SEMAPHORE)                                // Task is waiting the queue
+                {
+                    for (j = 0; j < semaphores[tcb[i].semaphore].queueSize; j++)
                     {
-                        for (j = 0; j < semaphores[tcb[i].semaphore].queueSize; j++)
+                        // Find task
+                        if (semaphores[tcb[i].semaphore].processQueue[j] == i)
                         {
-                            // Find task
-                            if (semaphores[tcb[i].semaphore].processQueue[j] == i)
+                            if ((i + 1) < semaphores[tcb[i].semaphore].queueSize)           // Move lower task to current tasks position
                             {
-                                if ((i + 1) < semaphores[tcb[i].semaphore].queueSize)       // Move lower task to current tasks position
-                                {
-                                    semaphores[tcb[i].semaphore].processQueue[j] = semaphores[tcb[i].semaphore].processQueue[j + 1];
-                                    semaphores[tcb[i].semaphore].queueSize--;               // Decrement queue size
-                                }
-                                else semaphores[tcb[i].semaphore].queueSize--;              // Decrement queue size
+                                semaphores[tcb[i].semaphore].processQueue[j] = semaphores[tcb[i].semaphore].processQueue[j + 1];
+                                semaphores[tcb[i].semaphore].queueSize--;                   // Decrement queue size
                             }
+                            else semaphores[tcb[i].semaphore].queueSize--;                  // Decrement queue size
                         }
                     }
-
-                    tcb[i].mutex      = 0;                                                  // Clear values from the TCB
-                    tcb[i].semaphore  = 0;                                                  // Clear values from the TCB
-                    tcb[i].ticks      = 0;                                                  // Clear values from the TCB
-                    tcb[i].state      = STATE_STOPPED;                                      // Mark the state of the thread as stopped
-
-                    break;                                                                  // Break out of the loop
                 }
+
+                tcb[i].mutex      = 0;                                                      // Clear values from the TCB
+                tcb[i].semaphore  = 0;                                                      // Clear values from the TCB
+                tcb[i].ticks      = 0;                                                      // Clear values from the TCB
+                tcb[i].state      = STATE_STOPPED;                                          // Mark the state of the thread as stopped
             }
 
             print((void *)funcToStop, "Stopped", CHAR);
@@ -865,12 +2173,9 @@ void svCallIsr(void)
         {
             char  *pidToStart = (char *)getArgs();                                          // Get the task to be restarted
 
-            for (i = 0; i < MAX_TASKS; i++)                                                 // Iterate over all tasks
+            for (i = findThreadByName(pidToStart, MAX_TASKS); i < MAX_TASKS; i = findThreadByName(pidToStart, i))
             {
-                if (!(strcmp(tcb[i].name, pidToStart)))                                     // Find the task to be started
-                {
-                    tcb[i].state = STATE_READY;                                             // Update the state to ready
-                }
+                tcb[i].state = STATE_READY;                                                 // Start every thread with the name
             }
             print((void *)pidToStart, "Running ", CHAR);
             enablePendSV();                                                                 // Enable PendSV
@@ -890,7 +2195,7 @@ void svCallIsr(void)
 
                 for (j = 0; j < semaphores[i].queueSize; j++)
                 {
-                    semaphoreInfo[i].processQueue[j] = tcb[semaphores[i].processQueue[j]].pid;
+                    semaphoreInfo[i].processQueue[j] = THREAD_HANDLE(semaphores[i].processQueue[j]);
                     strcpy(semaphoreInfo[i].processName[j], tcb[semaphores[i].processQueue[j]].name);
                 }
             }
@@ -904,7 +2209,7 @@ void svCallIsr(void)
 
                 for (j = 0; j < mutexes[i].queueSize; j++)
                 {
-                    mutexInfo[i].processQueue[j] = tcb[mutexes[i].processQueue[j]].pid;
+                    mutexInfo[i].processQueue[j] = THREAD_HANDLE(mutexes[i].processQueue[j]);
                     strcpy(mutexInfo[i].processName[j], tcb[mutexes[i].processQueue[j]].name);
                 }
             }
@@ -918,14 +2223,19 @@ void svCallIsr(void)
             uint32_t *psp = (uint32_t *)getPSP();
             uint32_t priority = *(psp + 1);
 
-            for (i = 0; i < MAX_TASKS; i++)
+            i = findThread(pid);                                                            // Handle or function address
+            if (i < MAX_TASKS && priority < NUM_PRIORITIES)
             {
-                if ((uint32_t)tcb[i].pid == pid)
+                if (tcb[i].threshold == tcb[i].priority || tcb[i].threshold > priority)
                 {
-                    tcb[i].priority = priority;
-                    tcb[i].currentPriority = priority;
-                    break;
+                    tcb[i].threshold = priority;                                            // Keep a raised threshold, never a lowered one
                 }
+                tcb[i].priority = priority;
+                tcb[i].currentPriority = priority;
+                END_AGING(i);
+#if CONFIG_PERIODIC_TASKS
+                tcb[i].autoPriority = false;                                                // Set by hand, the next admission keeps it
+#endif
             }
 
             putsUart0("Priority updated\r\n");
@@ -945,5 +2255,243 @@ void svCallIsr(void)
 
             break;
         }
+
+#if CONFIG_POOLS
+        case POOL_ALLOC:
+        {
+            pool_t *pool = (pool_t *)getArgs();                                             // Get the pool
+            uint32_t *psp = (uint32_t *)getPSP();
+            void **block = (void **)*(psp + 1);                                             // Get the location to return the block
+
+            *block = takeBlock(pool);
+            break;
+        }
+
+        case POOL_FREE:
+        {
+            pool_t *pool = (pool_t *)getArgs();                                             // Get the pool
+            uint32_t *psp = (uint32_t *)getPSP();
+
+            giveBlock(pool, (void *)*(psp + 1));                                            // Release the block
+            break;
+        }
+
+        case POOLS:
+        {
+            getPoolInfo((poolInfo_t *)getArgs());                                           // Snapshot every pool
+            break;
+        }
+#endif
+
+#if CONFIG_THREAD_HEAPS
+        case HEAP:
+        {
+            tlsf_t **heap = (tlsf_t **)getArgs();                                           // Get the location to return the heap
+            *heap = tcb[taskCurrent].heap;
+            break;
+        }
+#endif
+
+#if CONFIG_SHARED_MEMORY
+        case ATTACH:
+        {
+            char *name = (char *)getArgs();                                                 // Get the object name
+            uint32_t *psp = (uint32_t *)getPSP();
+            void **address = (void **)*(psp + 2);                                           // Get the location to return the address
+
+            *address = attachWindow(&tcb[taskCurrent].mpu, name, (bool)*(psp + 1));
+            applyTaskMpu(&tcb[taskCurrent].mpu);                                            // Window is usable on return
+            break;
+        }
+#endif
+
+        case EXIT:
+        {
+            releaseThread(taskCurrent);                                                     // Never returns to the thread
+            enablePendSV();
+            break;
+        }
+
+        case JOIN:
+        {
+            i = findThread((uint32_t)getArgs());                                            // Get the thread to wait for
+
+            if (i < MAX_TASKS && i != taskCurrent)
+            {
+                tcb[taskCurrent].join = i;
+                tcb[taskCurrent].state = STATE_BLOCKED_JOIN;                                // Woken by releaseThread
+                enablePendSV();
+            }
+            break;
+        }
+
+        case SPAWN:
+        {
+            threadRequest_t *request = (threadRequest_t *)getArgs();                        // Get the thread to create
+
+            request->handle = addThread(request->fn, request->arg, request->name, request->priority, request->stackBytes);
+            break;
+        }
+
+#if CONFIG_WORKERS
+        case SUBMIT_JOB:
+        {
+            job_t *job = (job_t *)getArgs();                                                // Get the job
+            uint32_t *psp = (uint32_t *)getPSP();
+            bool *ok = (bool *)*(psp + 1);                                                  // Get the location to return the status
+
+            *ok = enqueueJob(job);
+            dispatchJobs();                                                                 // Wake a waiting worker
+            enablePendSV();
+            break;
+        }
+
+        case TAKE_JOB:
+        {
+            job_t *job = (job_t *)getArgs();                                                // Get the location to copy the job to
+            uint32_t primask = disableInterrupts();                                         // No submission between the check and the block
+
+            if (!dequeueJob(job))
+            {
+                tcb[taskCurrent].jobSlot = job;                                             // Filled in by dispatchJobs
+                tcb[taskCurrent].state = STATE_BLOCKED_JOB;
+                enablePendSV();
+            }
+
+            restoreInterrupts(primask);
+            break;
+        }
+#endif
+
+        case THRESHOLD:
+        {
+            uint32_t pid = (uint32_t)getArgs();
+            uint32_t *psp = (uint32_t *)getPSP();
+            uint32_t threshold = *(psp + 1);
+
+            i = findThread(pid);                                                            // Handle or function address
+            if (i < MAX_TASKS && threshold < NUM_PRIORITIES)
+            {
+                tcb[i].threshold = (threshold < tcb[i].priority) ? threshold : tcb[i].priority;
+            }
+
+            enablePendSV();                                                                 // A lowered threshold may let a task in
+            break;
+        }
+
+#if CONFIG_CPU_BUDGETS
+        case BUDGET:
+        {
+            uint32_t pid = (uint32_t)getArgs();
+            uint32_t *psp = (uint32_t *)getPSP();
+            uint32_t budgetUs = *(psp + 1);
+
+            i = findThread(pid);                                                            // Handle or function address
+            if (i < MAX_TASKS && budgetUs <= BUDGET_PERIOD * 1000)
+            {
+                tcb[i].budget = budgetUs * TIMER_COUNTS_PER_US;
+                tcb[i].budgetSuspend = (bool)*(psp + 2);
+            }
+            break;
+        }
+#endif
+
+#if CONFIG_PRIORITY_AGING
+        case AGING:
+        {
+            uint32_t pid = (uint32_t)getArgs();
+            uint32_t *psp = (uint32_t *)getPSP();
+
+            i = findThread(pid);                                                            // Handle or function address
+            if (i < MAX_TASKS)
+            {
+                tcb[i].aging = (bool)*(psp + 1);
+                tcb[i].waitTicks = 0;
+                if (!tcb[i].aging && tcb[i].aged)                                           // Drop any raise already made
+                {
+                    tcb[i].currentPriority = tcb[i].agedFrom;
+                    tcb[i].aged = false;
+                }
+            }
+            break;
+        }
+#endif
+
+#if CONFIG_STRIDE_SCHEDULER
+        case TICKETS:
+        {
+            uint32_t pid = (uint32_t)getArgs();
+            uint32_t *psp = (uint32_t *)getPSP();
+            uint32_t tickets = *(psp + 1);
+
+            i = findThread(pid);                                                            // Handle or function address
+            if (i < MAX_TASKS && tickets && tickets <= STRIDE_ONE)
+            {
+                tcb[i].tickets = tickets;
+                tcb[i].stride = STRIDE_ONE / tickets;                                       // Applies from the next charge
+            }
+            break;
+        }
+#endif
+
+#if CONFIG_PERIODIC_TASKS
+        case RTSTAT:
+        {
+            rtStatInfo_t *rtStatInfo = (rtStatInfo_t *)getArgs();
+
+            for (i = 0; i < MAX_TASKS; i++)
+            {
+                rtStatInfo[i].pid = (tcb[i].state != STATE_INVALID && tcb[i].periodUs) ? THREAD_HANDLE(i) : 0;
+                if (!rtStatInfo[i].pid)     continue;                                       // Not a periodic thread
+
+                rtStatInfo[i].periodUs = tcb[i].periodUs;
+                rtStatInfo[i].wcetUs = tcb[i].wcetUs;
+                rtStatInfo[i].execMaxUs = tcb[i].execMax / TIMER_COUNTS_PER_US;
+                rtStatInfo[i].jobs = tcb[i].jobs;
+                rtStatInfo[i].misses = tcb[i].misses;
+                rtStatInfo[i].responseMinUs = tcb[i].jobs ? tcb[i].responseMin / TIMER_COUNTS_PER_US : 0;
+                rtStatInfo[i].responseAvgUs = tcb[i].jobs ? (uint32_t)(tcb[i].responseSum / tcb[i].jobs) / TIMER_COUNTS_PER_US : 0;
+                rtStatInfo[i].responseMaxUs = tcb[i].responseMax / TIMER_COUNTS_PER_US;
+                strcpy(rtStatInfo[i].name, tcb[i].name);
+            }
+            break;
+        }
+#endif
+
+#if CONFIG_TRACE
+        case TRACE_READ:
+        {
+            copyTrace((traceChunk_t *)getArgs());                                           // Next run of records
+            break;
+        }
+#endif
+
+        case SLICE:
+        {
+            uint32_t priority = (uint32_t)getArgs();                                        // Get the priority level
+            uint32_t *psp = (uint32_t *)getPSP();
+            uint16_t ticks = (uint16_t)*(psp + 1);
+
+            if (priority < NUM_PRIORITIES && ticks)     timeSlice_g[priority] = ticks;
+            break;
+        }
+
+        case MEMINFO:
+        {
+            heapInfo_t *heapInfo = (heapInfo_t *)getArgs();                                 // Get the location of the snapshot
+
+            getHeapInfo(heapInfo);
+            for (i = 0; i < heapInfo->allocationCount; i++)                                 // Stack allocations start at the guard
+            {
+                for (j = 0; j < MAX_TASKS; j++)
+                {
+                    if (tcb[j].state != STATE_INVALID && (uint32_t)tcb[j].stackBase - tcb[j].mpu.guardSize == heapInfo->allocations[i].address)
+                    {
+                        strcpy(heapInfo->allocations[i].owner, tcb[j].name);
+                    }
+                }
+            }
+            break;
+        }
     }
 }
@@ -17,6 +17,8 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "kernelConfig.h"
+#include "sramConfig.h"
 
 //-----------------------------------------------------------------------------
 // RTOS Defines and Kernel Variables
@@ -25,9 +27,11 @@
 // function pointer
 typedef void (*_fn)();
 
+// thread handle, tag | generation << 8 | TCB index, 0 is never a valid handle
+typedef uint32_t thread_t;
+#define THREAD_HANDLE_TAG       0x01000000          // Above any code address, so handles and function addresses never collide
+
 // mutex
-#define MAX_MUTEXES 1
-#define MAX_MUTEX_QUEUE_SIZE 2
 typedef struct _mutex
 {
     bool lock;
@@ -35,25 +39,31 @@ typedef struct _mutex
     uint32_t processQueue[MAX_MUTEX_QUEUE_SIZE];
     uint32_t lockedBy;
 } mutex;
-mutex mutexes[MAX_MUTEXES];
+extern mutex mutexes[MAX_MUTEXES];
 #define resource 0
 
 // semaphore
-#define MAX_SEMAPHORES 3
-#define MAX_SEMAPHORE_QUEUE_SIZE 2
 typedef struct _semaphore
 {
     uint16_t count;
     uint16_t queueSize;
     uint32_t processQueue[MAX_SEMAPHORE_QUEUE_SIZE];
 } semaphore;
-semaphore semaphores[MAX_SEMAPHORES];
+extern semaphore semaphores[MAX_SEMAPHORES];
 #define keyPressed 0
 #define keyReleased 1
 #define flashReq 2
 
-// tasks
-#define MAX_TASKS 12
+// createPeriodicThread priority asking for a rate-monotonic assignment
+#define RM_PRIORITY             0xFF
+
+// static stack for createThreadStatic, a power of two of at least 32 bytes aligned to its size so one MPU region covers it
+// placed in the STATIC_STACK_SRAM_SIZE area at the top of SRAM, needs SINGLE_REGION_STACKS
+// all of it is usable stack, static stacks get no overflow guard
+#define STATIC_STACK(name, bytes) \
+    typedef char name##_sizeCheck[((bytes) >= 32 && !((bytes) & ((bytes) - 1)) && \
+                                   (bytes) <= STATIC_STACK_SRAM_SIZE && SINGLE_REGION_STACKS) ? 1 : -1]; \
+    uint8_t name[bytes] __attribute__((aligned(bytes), section(".staticStack")))
 
 //-----------------------------------------------------------------------------
 // Subroutines
@@ -66,9 +76,31 @@ void initRtos(void);
 void startRtos(void);
 
 bool createThread(_fn fn, const char name[], uint8_t priority, uint32_t stackBytes);
+bool createThreadWithHeap(_fn fn, const char name[], uint8_t priority, uint32_t stackBytes, uint32_t heapBytes);
+#if CONFIG_PERIODIC_TASKS
+bool createPeriodicThread(_fn fn, const char name[], uint8_t priority, uint32_t stackBytes, uint32_t periodMs, uint32_t wcetUs);
+#endif
+bool createThreadStatic(_fn fn, const char name[], uint8_t priority, uint8_t slot, void *stack, uint32_t stackBytes);
+thread_t createThreadWithArg(_fn fn, void *arg, const char name[], uint8_t priority, uint32_t stackBytes);
+void threadExit(void);
+void threadJoin(thread_t thread);
+#if CONFIG_WORKERS
+void dispatchJobs(void);
+#endif
 void restartThread(_fn fn);
 void stopThread(_fn fn);
 void setThreadPriority(_fn fn, uint8_t priority);
+void setThreadThreshold(_fn fn, uint8_t threshold);
+#if CONFIG_CPU_BUDGETS
+void setThreadBudget(_fn fn, uint32_t budgetUs, bool suspend);
+#endif
+#if CONFIG_PRIORITY_AGING
+void setThreadAging(_fn fn, bool on);
+#endif
+#if CONFIG_STRIDE_SCHEDULER
+void setThreadTickets(_fn fn, uint16_t tickets);
+#endif
+void setTimeSlice(uint8_t priority, uint16_t ticks);
 
 void yield(void);
 void sleep(uint32_t tick);
@@ -76,6 +108,14 @@ void lock(int8_t mutex);
 void unlock(int8_t mutex);
 void wait(int8_t semaphore);
 void post(int8_t semaphore);
+#if CONFIG_THREAD_HEAPS
+void *threadMalloc(uint32_t size);
+void threadFree(void *ptr);
+#endif
+#if CONFIG_SHARED_MEMORY
+void *attachSharedMemory(const char name[], bool writable);
+#endif
+bool checkStackOverflow(uint32_t flags, uint32_t faultAddr);
 
 void systickIsr(void);
 void pendSvIsr(void);
@@ -0,0 +1,123 @@
+/**
+*      @file kernelConfig.h
+*      @author Prithvi Bhat
+*      @brief Kernel build configuration
+*               Every static kernel table is sized here, and the optional features can be left out of the build
+*               The values are checked at compile time so a bad configuration fails to build instead of failing at run time
+**/
+
+#ifndef KERNEL_CONFIG_H
+#define KERNEL_CONFIG_H
+
+// Tasks
+#define MAX_TASKS                   12          // TCB records, including the idle task and the shell
+#define NUM_PRIORITIES              32          // Priority levels, 0 is the highest
+#define DEFAULT_TIME_SLICE          10          // Ticks an equal priority task runs before the next one gets the CPU
+#define NAME_BUCKETS                16          // Buckets of the task name index (power of two)
+
+// Mutexes and semaphores
+#define MAX_MUTEXES                 1           // Mutexes that can be initialised
+#define MAX_MUTEX_QUEUE_SIZE        2           // Tasks that can wait on one mutex
+#define MAX_SEMAPHORES              3           // Semaphores that can be initialised
+#define MAX_SEMAPHORE_QUEUE_SIZE    2           // Tasks that can wait on one semaphore
+
+/**
+*      Optional features
+*      1: the feature, its service calls and its shell command are built
+*      0: the feature is left out along with its tables
+*      The kernel tables and the system stack share the KERNEL_SRAM_SIZE bytes of sramConfig.h, kernel.c fails to
+*      build when they do not fit. Turning on the features that are off by default needs KERNEL_SRAM_SIZE 0x2000
+**/
+#define CONFIG_POOLS                1           // Fixed-block memory pools (pool.c)
+#define MAX_POOLS                   4           // Pools that can be registered
+
+#define CONFIG_THREAD_HEAPS         1           // Private TLSF heaps above thread stacks (tlsf.c)
+
+#define CONFIG_SHARED_MEMORY        1           // Named shared memory mapped through MPU windows
+#define MAX_SHARED_MEMORY           4           // Shared memory objects that can be created
+
+#define CONFIG_CPU_BUDGETS          1           // CPU time limits per thread, enforced every budget period
+#define BUDGET_PERIOD               100         // Ticks between budget replenishments
+
+#define CONFIG_PRIORITY_AGING       1           // Opt-in raising of threads that wait too long to run
+#define AGING_INTERVAL              50          // Ticks of waiting per level raised
+#define AGING_LIMIT                 1           // Highest level aging can reach, levels above stay reserved
+
+#define CONFIG_STRIDE_SCHEDULER     1           // Proportional share scheduling mode (sched stride)
+#define DEFAULT_TICKETS             100         // Tickets of a new thread
+#define STRIDE_ONE                  (1 << 16)   // Stride of a thread holding one ticket
+#define STRIDE_COUNT_SHIFT          10          // CPU time is charged in units of 1024 timer counts (25.6 us)
+
+#define CONFIG_PERIODIC_TASKS       0           // Periodic threads with admission control (createPeriodicThread), 56 bytes of kernel SRAM per TCB record
+#define ADMISSION_REJECT            1           // 1: refuse a thread that makes the set unschedulable, 0: warn and admit
+#define RM_PRIORITY_BASE            1           // Highest level given out by rate-monotonic assignment
+#define MAX_PERIOD_MS               100000      // Longest period, deadlines must fit the 32 bit timer count (107 s)
+
+#define CONFIG_TRACE                0           // Binary trace ring of kernel events (trace.c), sent by the trace command
+#define TRACE_RECORDS               64          // Records held (power of two), costs TRACE_RECORDS * 8 + 4 bytes of kernel SRAM
+
+#define CONFIG_WORKERS              1           // Worker threads fed by a job queue (workers.c)
+#define MAX_WORKERS                 4           // Worker threads that can be started
+#define MAX_JOBS                    8           // Jobs that can wait in the queue
+
+//-----------------------------------------------------------------------------
+// Validation
+//-----------------------------------------------------------------------------
+
+#if MAX_TASKS < 2 || MAX_TASKS > 255
+#error "MAX_TASKS must leave room for the idle task and fit the 8 bit index of a thread handle"
+#endif
+
+#if NUM_PRIORITIES < 1 || NUM_PRIORITIES > 255
+#error "NUM_PRIORITIES must fit the 8 bit priority of a TCB record, 0xFF is kept as a sentinel"
+#endif
+
+#if DEFAULT_TIME_SLICE < 1 || DEFAULT_TIME_SLICE > 65535
+#error "DEFAULT_TIME_SLICE must be between 1 and 65535 ticks"
+#endif
+
+#if NAME_BUCKETS < 1 || (NAME_BUCKETS & (NAME_BUCKETS - 1))
+#error "NAME_BUCKETS must be a power of two"
+#endif
+
+#if MAX_MUTEXES < 1 || MAX_MUTEXES > 127 || MAX_SEMAPHORES < 1 || MAX_SEMAPHORES > 127
+#error "MAX_MUTEXES and MAX_SEMAPHORES must be between 1 and 127, lock() and wait() take an int8_t"
+#endif
+
+#if MAX_MUTEX_QUEUE_SIZE < 1 || MAX_MUTEX_QUEUE_SIZE > MAX_TASKS || MAX_SEMAPHORE_QUEUE_SIZE < 1 || MAX_SEMAPHORE_QUEUE_SIZE > MAX_TASKS
+#error "Mutex and semaphore queues must hold between 1 and MAX_TASKS tasks"
+#endif
+
+#if CONFIG_POOLS && (MAX_POOLS < 1 || MAX_POOLS > 255)
+#error "MAX_POOLS must be between 1 and 255"
+#endif
+
+#if CONFIG_SHARED_MEMORY && (MAX_SHARED_MEMORY < 1 || MAX_SHARED_MEMORY > 255)
+#error "MAX_SHARED_MEMORY must be between 1 and 255"
+#endif
+
+#if CONFIG_CPU_BUDGETS && (BUDGET_PERIOD < 1 || BUDGET_PERIOD > 65535)
+#error "BUDGET_PERIOD must be between 1 and 65535 ticks"
+#endif
+
+#if CONFIG_PRIORITY_AGING && (AGING_INTERVAL < 1 || AGING_INTERVAL > 65535 || AGING_LIMIT >= NUM_PRIORITIES)
+#error "AGING_INTERVAL must be between 1 and 65535 ticks and AGING_LIMIT a valid priority"
+#endif
+
+#if CONFIG_STRIDE_SCHEDULER && (DEFAULT_TICKETS < 1 || DEFAULT_TICKETS > STRIDE_ONE || STRIDE_ONE > 65535 + 1)
+#error "DEFAULT_TICKETS must be between 1 and STRIDE_ONE, and STRIDE_ONE at most 65536"
+#endif
+
+#if CONFIG_PERIODIC_TASKS && (RM_PRIORITY_BASE >= NUM_PRIORITIES - 1 || MAX_PERIOD_MS < 1 || MAX_PERIOD_MS > 100000)
+#error "RM_PRIORITY_BASE must be above the idle level and MAX_PERIOD_MS between 1 and 100000"
+#endif
+
+#if CONFIG_TRACE && (TRACE_RECORDS < 8 || (TRACE_RECORDS & (TRACE_RECORDS - 1)))
+#error "TRACE_RECORDS must be a power of two of at least 8"
+#endif
+
+#if CONFIG_WORKERS && (MAX_WORKERS < 1 || MAX_WORKERS >= MAX_TASKS || MAX_JOBS < 1 || MAX_JOBS > 255)
+#error "MAX_WORKERS must leave a TCB record for the idle task and MAX_JOBS must be between 1 and 255"
+#endif
+
+#endif
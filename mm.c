@@ -15,187 +15,378 @@
 #include <stdint.h>
 #include "tm4c123gh6pm.h"
 #include "mm.h"
+#include "systemRegisters.h"
+#include "strings.h"
 #include <stdbool.h>
 
 // User added
 #define NULL        0x00000000
 
-#define BLOCK_SIZE_1    512
-#define BLOCK_SIZE_2    1024
-#define BLOCK_SIZE_3    1536
-
-#define REGION_4K0_BASE_ADDR    0x20000000
-#define REGION_4K1_BASE_ADDR    0x20001000
-#define REGION_4K2_BASE_ADDR    0x20004000
-#define REGION_4K3_BASE_ADDR    0x20005000
-#define REGION_8K1_BASE_ADDR    0x20002000
-#define REGION_8K2_BASE_ADDR    0x20006000
-
-
-#define REGION_4K0_TOP_ADDR     0x20000FFF
-#define REGION_4K1_TOP_ADDR     0x20001FFF
-#define REGION_8K1_TOP_ADDR     0x20003FFF
-#define REGION_4K2_TOP_ADDR     0x20004FFF
-#define REGION_4K3_TOP_ADDR     0x20005FFF
-#define REGION_8K2_TOP_ADDR     0x20007FFF
-
-#define MPU_SRAM_8K2    0x00000007  // SRAM region 5        (User added)
-#define MPU_SRAM_4K3    0x00000006  // SRAM region 4        (User added)
-#define MPU_SRAM_4K2    0x00000005  // SRAM region 3        (User added)
-#define MPU_SRAM_8K1    0x00000004  // SRAM region 2        (User added)
-#define MPU_SRAM_4K1    0x00000003  // SRAM region 1        (User added)
+#define MPU_SRAM_WINDOW 0x00000004  // First shared memory window of the running task (User added)
+#define MPU_SRAM_TASK   0x00000003  // Stack region of the running task (User added)
+#define MPU_SRAM_HEAP   0x00000003  // First heap SRAM region (User added)
 #define MPU_SRAM_OS     0x00000002  // SRAM region 0        (User added)
 #define NVIC_MPU_NUMBER_FLASH       0x00000001  // Flash region         (User added)
 #define NVIC_MPU_ATTR_AP_K          0x01000000  // Kernel Full Access       (User added)
 #define NVIC_MPU_ATTR_AP_F          0x03000000  // Access Privilege Full    (User added)
+#define NVIC_MPU_ATTR_AP_R          0x02000000  // Unprivileged Read Only   (User added)
 #define NVIC_MPU_ATTR_TEX_N         0x00000000  // Type Extension Mask      (User added)
 #define NVIC_MPU_ATTR_SIZE_FULL     (31 << 1)   // Region Size Mask Full    (User added)
 #define NVIC_MPU_ATTR_SIZE_FLASH    (17 << 1)   // Region Size Mask Flash   (User added)
-#define NVIC_MPU_ATTR_SIZE_SRAM_8K  (12 << 1)   // Region Size Mask SRAM    (User added)
-#define NVIC_MPU_ATTR_SIZE_SRAM_4K  (11 << 1)   // Region Size Mask SRAM    (User added)
-
-#define TOTAL_REGIONS   40
-
-#define BLOCK_4K1_START 0
-#define BLOCK_4K1_END   7
-#define BLOCK_8K1_START 8
-#define BLOCK_8K1_END   15
-#define BLOCK_4K2_START 16
-#define BLOCK_4K2_END   23
-#define BLOCK_4K3_START 24
-#define BLOCK_4K3_END   31
-#define BLOCK_8K2_START 32
-#define BLOCK_8K2_END   39
-
-#define SUBREGIONS_512(size_in_bytes)    (size_in_bytes / BLOCK_SIZE_1)   // Determine the number of 512B sub regions required for the allotment
-#define SUBREGIONS_1024(size_in_bytes)   (size_in_bytes / BLOCK_SIZE_2)   // Determine the number of 1024B sub regions required for the allotment
-
-#define RETURN_VALID    if (retVal != NULL) return (void *)retVal
+#define NVIC_MPU_ATTR_SIZE(bytes)   ((30 - countLeadingZeros(bytes)) << 1)  // Region Size Mask for a power of two size
+
+#define SUBREGIONS_PER_REGION   8
+#define TOTAL_REGIONS           (NUM_SRAM_REGIONS * SUBREGIONS_PER_REGION)
+
+#define LEDGER_BIT(index)                   ((uint64_t)1 << (index))                                // Ledger bit of a single subregion
+#define LEDGER_RANGE(start, end)            (((uint64_t)2 << (end)) - LEDGER_BIT(start))            // Ledger bits of subregions start to end (inclusive)
+#define ALIGNED_STARTS(subRegions)          (0xFF / ((1 << (subRegions)) - 1))                      // Subregions of a region on a multiple of subRegions
+
 #define RETURN_INVALID  return (void *)NULL
 
-/**
-*      @brief Structure to hold the metadata of the Heap
-**/
-typedef struct
-{
-    void *address;                                              // Base of the allocation
-    uint8_t subRegions;                                         // Number of subregions allocated here
-} heapMetadata_t;
+#if (KERNEL_SRAM_SIZE & (KERNEL_SRAM_SIZE - 1)) || (SRAM_BASE_ADDR % KERNEL_SRAM_SIZE)
+#error "KERNEL_SRAM_SIZE must be a power of two and SRAM_BASE_ADDR aligned to it"
+#endif
+
+// Heap bounds, placed by the linker command file after the kernel SRAM
+extern uint8_t __heap_base;
+extern uint8_t __heap_end;
 
 // Global variables
-uint8_t heapTop_g = 0, allotment_g[TOTAL_REGIONS] = {0, };      // A ledger to keep track allocated subregions, initialised to 0
+const uint32_t heapRegionSizes_g[NUM_SRAM_REGIONS] = HEAP_REGION_SIZES;
+heapRegion_t heapRegions_g[NUM_SRAM_REGIONS];                   // Region map, built from the configuration by initHeapRegions
+uint8_t heapRegionCount_g = 0;                                  // Number of valid entries in the region map
+uint64_t intersections_g[NUM_SRAM_REGIONS - 1];                 // Ledger bits of the subregion pairs straddling region boundaries
+uint8_t intersectionCount_g = 0;                                // Number of valid entries in the intersection list
+uint8_t heapTop_g = 0;
+uint64_t heapLedger_g = 0;                                      // A ledger to keep track allocated subregions, one bit per subregion (1 = allocated)
 heapMetadata_t heapMetadata_g[TOTAL_REGIONS] = {{0, 0}, };      // Initialise allotment metadata
+#if CONFIG_SHARED_MEMORY
+sharedMemory_t sharedMemory_g[MAX_SHARED_MEMORY];               // Named shared memory objects
+uint8_t sharedMemoryCount_g = 0;                                // Number of valid shared memory objects
+uint8_t windowsLoaded_g = 0;                                    // Number of window regions enabled in the MPU
+#endif
 
 //-----------------------------------------------------------------------------
 // Subroutines
 //-----------------------------------------------------------------------------
 
 /**
- *      @brief Get the Allocation object
- *      @param allotment_g  pointer to the heap ledger array
- *      @param heapMetadata_g pointer to the metadata structure array
- *      @param size of the requested space in bytes
- *      @param subRegions number of subregions occupied by the requested space
- *      @param startRange start index of the region (block offset from 0)
- *      @param endRange end index of the region (block offset from 0)
- *      @param baseAddr base address of the region
- *      @param offset from 0
- *      @param blockSize size of each subregion in the region
- *      @return void* an address to the base of allocated heap space
+ *      @brief Build the heap region map from the configured region sizes and the linker placed heap bounds
+ *              The subregions on either side of a boundary between regions of different block sizes are kept aside,
+ *              so that a request too large for one subregion on either side can straddle the boundary
+ *      @return true if every region is a power of two, aligned to its size and inside the heap
+ *      @return false if the configuration is invalid (no heap will be available)
  **/
-void *getAllocation(uint8_t subRegions, uint8_t startRange, uint8_t endRange, uint32_t baseAddr, int16_t offset, uint16_t blockSize)
+bool initHeapRegions(void)
 {
-    uint8_t fragmented = 0, emptySubRegions = 0, index;
+    uint32_t base = (uintptr_t)&__heap_base;
+    uint32_t size;
+    uint8_t i, bit;
 
-    // Check for space in the first 8K region
-    for (index = startRange; index <= endRange; index++)                            // +-1 to leave space for 1.5K blocks
+    for (i = 0; i < NUM_SRAM_REGIONS; i++)
     {
-        if (!(allotment_g[index]))                                                  // Check if space is unallocated
+        size = heapRegionSizes_g[i];
+        if ((size & (size - 1)) || (size < 256) || (base & (size - 1)) || ((base + size) > (uintptr_t)&__heap_end))
         {
-            if (fragmented)                                                         // Clear fragmentation flags if set
-            {
-                fragmented = 0;
-                emptySubRegions = 0;                                                // Reset count of contiguous empty spaces
-            }
-
-            emptySubRegions++;                                                      // Keep count to ensure space will fit
-
-            if (emptySubRegions >= subRegions)                                      // Check if contiguous empty spaces match the required number of regions
-            {
-                while (emptySubRegions > 0)
-                {
-                    if (index > 1)  allotment_g[index--] = 1;                       // To indicate that the space has been alloted
-                    else        allotment_g[index] = 1;                             // To indicate that the space has been alloted
-                    emptySubRegions--;
-                }
-
-                heapMetadata_g[heapTop_g].subRegions = subRegions;                  // Record size and allocated address
-                heapMetadata_g[heapTop_g].address = (void *)(baseAddr + ((index + (offset)) * blockSize));
-
-                return (void *)heapMetadata_g[heapTop_g++].address;                 // Return the address
-            }
+            return false;
         }
-        else
+
+        heapRegions_g[i].baseAddr   = base;
+        heapRegions_g[i].size       = size;
+        heapRegions_g[i].blockSize  = size / SUBREGIONS_PER_REGION;
+        heapRegions_g[i].window     = LEDGER_RANGE(i * SUBREGIONS_PER_REGION, (i + 1) * SUBREGIONS_PER_REGION - 1);
+        base += size;
+    }
+
+    for (i = 0; i < (NUM_SRAM_REGIONS - 1); i++)
+    {
+        if (heapRegions_g[i].blockSize != heapRegions_g[i + 1].blockSize)
+        {
+            bit = (i + 1) * SUBREGIONS_PER_REGION;                                  // First subregion above the boundary
+            intersections_g[intersectionCount_g++] = LEDGER_RANGE(bit - 1, bit);
+            heapRegions_g[i].window     &= ~LEDGER_BIT(bit - 1);
+            heapRegions_g[i + 1].window &= ~LEDGER_BIT(bit);
+        }
+    }
+
+    heapRegionCount_g = NUM_SRAM_REGIONS;
+    return true;
+}
+
+/**
+ *      @brief Find the index of the lowest set bit in a 64 bit mask
+ *      @param mask to be searched (must be non-zero)
+ *      @return uint8_t index of the lowest set bit
+ **/
+uint8_t lowestSetBit(uint64_t mask)
+{
+    if ((uint32_t)mask)     return countTrailingZeros((uint32_t)mask);
+    else                    return 32 + countTrailingZeros((uint32_t)(mask >> 32));
+}
+
+/**
+ *      @brief Find every run of contiguous free subregions in a window of the ledger
+ *              The free map is repeatedly AND-ed with a shifted copy of itself, doubling the run length each time,
+ *              so that a bit survives only if it starts a free run of the requested length
+ *      @param window ledger bits that the run may occupy
+ *      @param subRegions length of the run
+ *      @return uint64_t ledger bits at which a free run of the requested length starts
+ **/
+uint64_t freeRuns(uint64_t window, uint8_t subRegions)
+{
+    uint64_t runs = ~heapLedger_g & window;                                         // Free subregions within the window
+    uint8_t length = 1;                                                             // Run length represented by each set bit
+
+    while (runs && (length << 1) <= subRegions)
+    {
+        runs &= runs >> length;                                                     // Double the run length
+        length <<= 1;
+    }
+
+    if (runs && length < subRegions)
+    {
+        runs &= runs >> (subRegions - length);                                      // Extend to the exact run length
+    }
+
+    return runs;
+}
+
+/**
+ *      @brief Find the lowest run of contiguous free subregions in a window of the ledger
+ *      @param window ledger bits that the run may occupy
+ *      @param subRegions length of the run
+ *      @return int8_t ledger index of the first subregion of the run, -1 if nothing fits
+ **/
+int8_t findFreeRun(uint64_t window, uint8_t subRegions)
+{
+    uint64_t runs = freeRuns(window, subRegions);
+    return runs ? (int8_t)lowestSetBit(runs) : -1;
+}
+
+/**
+ *      @brief Round a size up to the next power of two
+ *      @param size_in_bytes size to be rounded (non-zero)
+ *      @return uint32_t the smallest power of two not below the size
+ **/
+uint32_t roundUpPowerOfTwo(uint32_t size_in_bytes)
+{
+    return (size_in_bytes <= 1) ? 1 : ((uint32_t)1 << (32 - countLeadingZeros(size_in_bytes - 1)));
+}
+
+/**
+ *      @brief Function to find the ledger bit of the subregion holding an address
+ *      @param address inside the heap
+ *      @return uint8_t ledger index, TOTAL_REGIONS if the address is outside the heap
+ **/
+uint8_t getLedgerIndex(uint32_t address)
+{
+    uint8_t i;
+
+    for (i = 0; i < heapRegionCount_g; i++)
+    {
+        if (address >= heapRegions_g[i].baseAddr && address < heapRegions_g[i].baseAddr + heapRegions_g[i].size)
         {
-            fragmented = 1;                                                         // Set fragmented flag
+            return i * SUBREGIONS_PER_REGION + (address - heapRegions_g[i].baseAddr) / heapRegions_g[i].blockSize;
         }
     }
-    return (void *)NULL;
+    return TOTAL_REGIONS;
+}
+
+/**
+ *      @brief Mark a run of subregions as allocated and record it in the metadata
+ *      @param index ledger index of the first subregion of the run
+ *      @param subRegions length of the run
+ *      @return void* an address to the base of allocated heap space
+ **/
+void *getAllocation(uint8_t index, uint8_t subRegions)
+{
+    const heapRegion_t *region = &heapRegions_g[index / SUBREGIONS_PER_REGION];
+
+    heapLedger_g |= LEDGER_RANGE(index, index + subRegions - 1);                    // Indicate that the space has been alloted
+
+    heapMetadata_g[heapTop_g].subRegions = subRegions;                              // Record size and allocated address
+    heapMetadata_g[heapTop_g].address = (void *)(uintptr_t)(region->baseAddr + ((index % SUBREGIONS_PER_REGION) * region->blockSize));
+
+    return (void *)heapMetadata_g[heapTop_g++].address;                             // Return the address
 }
 
 /**
  *      @brief Function to allocate requested memory from heap
+ *              Requests go to the regions with the smallest block size that holds them in one subregion
+ *              (or the largest block size if none does), then to any other region they fit in
  *      @param size requested in bytes
  *      @return void* address to base of the allocated space
  **/
 void * mallocFromHeap(uint32_t size_in_bytes)
 {
-    void *retVal;
+    uint8_t i, pass, subRegions;
+    uint16_t blockSize, preferred = 0;
+    heapRegion_t *lower, *upper;
+    int8_t index;
 
-    // Standardize size
-    if      (size_in_bytes <= BLOCK_SIZE_1)  size_in_bytes = BLOCK_SIZE_1;
-    else if (size_in_bytes <= BLOCK_SIZE_2)  size_in_bytes = BLOCK_SIZE_2;
-    else    (size_in_bytes = (size_in_bytes <= BLOCK_SIZE_3) ? BLOCK_SIZE_3 : ((size_in_bytes % BLOCK_SIZE_2) ? ((size_in_bytes / BLOCK_SIZE_2) + 1) * BLOCK_SIZE_2 : size_in_bytes));
+    if (!size_in_bytes || heapTop_g >= TOTAL_REGIONS)   RETURN_INVALID;             // No room left to record the allocation
 
-    // If request is for one of three 1.5K intersections
-    if (size_in_bytes == BLOCK_SIZE_3)
+    // If request fits one of the intersections but neither of its subregions alone
+    for (i = 0; i < intersectionCount_g; i++)
     {
-        retVal = getAllocation((2), (BLOCK_4K1_END), (BLOCK_8K1_START), REGION_4K1_BASE_ADDR, 1, BLOCK_SIZE_1);
-        RETURN_VALID;
+        index = lowestSetBit(intersections_g[i]);
+        lower = &heapRegions_g[index / SUBREGIONS_PER_REGION];
+        upper = lower + 1;
+
+        if ((size_in_bytes > lower->blockSize) && (size_in_bytes > upper->blockSize)
+            && (size_in_bytes <= (uint32_t)lower->blockSize + upper->blockSize)
+            && !(heapLedger_g & intersections_g[i]))                                // Both halves of the intersection are free
+        {
+            return getAllocation(index, 2);
+        }
+    }
 
-        retVal = getAllocation((2), (BLOCK_8K1_END), (BLOCK_4K2_START), REGION_8K1_BASE_ADDR, -7, BLOCK_SIZE_2);
-        RETURN_VALID;
+    for (i = 0; i < heapRegionCount_g; i++)                                         // Smallest block size holding the request
+    {
+        blockSize = heapRegions_g[i].blockSize;
+        if (blockSize >= size_in_bytes && (!preferred || blockSize < preferred))    preferred = blockSize;
+    }
 
-        retVal = getAllocation((2), (BLOCK_4K3_END), (BLOCK_8K2_START), REGION_4K3_BASE_ADDR, -23, BLOCK_SIZE_1);
-        RETURN_VALID;
+    if (!preferred)                                                                 // Else the largest block size
+    {
+        for (i = 0; i < heapRegionCount_g; i++)
+        {
+            if (heapRegions_g[i].blockSize > preferred)     preferred = heapRegions_g[i].blockSize;
+        }
     }
 
-    // Make an allotment from one of the three 4K blocks
-    if (SUBREGIONS_512(size_in_bytes) < SUBREGIONS_1024(size_in_bytes) || !SUBREGIONS_1024(size_in_bytes))
+    for (pass = 0; pass < 2; pass++)                                                // Preferred block size first, then the rest
     {
-        retVal = getAllocation((SUBREGIONS_512(size_in_bytes)), (BLOCK_4K1_START), (BLOCK_4K1_END - 1), REGION_4K1_BASE_ADDR, 0, BLOCK_SIZE_1);
-        RETURN_VALID;
+        for (i = 0; i < heapRegionCount_g; i++)
+        {
+            blockSize = heapRegions_g[i].blockSize;
+            if ((blockSize == preferred) == (pass != 0))    continue;
 
-        retVal = getAllocation((SUBREGIONS_512(size_in_bytes)), (BLOCK_4K2_START + 1), BLOCK_4K2_END, REGION_4K2_BASE_ADDR, -15, BLOCK_SIZE_1);
-        RETURN_VALID;
+            subRegions = (size_in_bytes + blockSize - 1) / blockSize;
+            if (subRegions > SUBREGIONS_PER_REGION)         continue;
 
-        retVal = getAllocation((SUBREGIONS_512(size_in_bytes)), (BLOCK_4K3_START), (BLOCK_4K3_END - 1), REGION_4K3_BASE_ADDR, -22, BLOCK_SIZE_1);
-        RETURN_VALID;
+            index = findFreeRun(heapRegions_g[i].window, subRegions);
+            if (index >= 0)     return getAllocation(index, subRegions);
+        }
     }
 
-    // Make an allotment from one of the two 8K blocks
-    else
+    RETURN_INVALID;
+}
+
+/**
+ *      @brief Function to allocate a naturally aligned power of two block from heap
+ *              The block starts on a multiple of its size, so a single MPU region covers it exactly
+ *              Regions whose subregions are no larger than the block are tried first to avoid waste
+ *      @param size_in_bytes requested size, rounded up to a power of two of at least 32 bytes
+ *      @return void* address to base of the allocated space
+ **/
+void * mallocAlignedFromHeap(uint32_t size_in_bytes)
+{
+    uint8_t i, pass, subRegions;
+    uint64_t runs;
+    uint32_t size;
+
+    if (!size_in_bytes || heapTop_g >= TOTAL_REGIONS)   RETURN_INVALID;             // No room left to record the allocation
+
+    size = roundUpPowerOfTwo(size_in_bytes);
+    if (size < 32)  size = 32;                                                      // Smallest MPU region
+
+    for (pass = 0; pass < 2; pass++)                                                // Exact subregion multiples first, then the rest
     {
-        retVal = getAllocation((SUBREGIONS_1024(size_in_bytes)), (BLOCK_8K1_START + 1), (BLOCK_8K1_END - 1), REGION_8K1_BASE_ADDR, -7, BLOCK_SIZE_2);
-        RETURN_VALID;
+        for (i = 0; i < heapRegionCount_g; i++)
+        {
+            if (heapRegions_g[i].size < size)                               continue;
+            if ((heapRegions_g[i].blockSize <= size) == (pass != 0))        continue;
+
+            subRegions = (size > heapRegions_g[i].blockSize) ? (size / heapRegions_g[i].blockSize) : 1;
+
+            runs = freeRuns(LEDGER_RANGE(i * SUBREGIONS_PER_REGION, (i + 1) * SUBREGIONS_PER_REGION - 1), subRegions);
+            runs &= (uint64_t)ALIGNED_STARTS(subRegions) << (i * SUBREGIONS_PER_REGION);  // Only naturally aligned starts
 
-        retVal = getAllocation((SUBREGIONS_1024(size_in_bytes)), (BLOCK_8K2_START + 1), (BLOCK_8K2_END), REGION_8K2_BASE_ADDR, -31, BLOCK_SIZE_2);
-        RETURN_VALID;
+            if (runs)   return getAllocation(lowestSetBit(runs), subRegions);
+        }
     }
 
     RETURN_INVALID;
 }
 
+/**
+ *      @brief Function to allocate a stack from heap in the layout required by the MPU mode
+ *              With STACK_GUARD the guard subregion is added below the requested size, never taken out of it
+ *      @param size_in_bytes requested size, all of it usable above the guard
+ *      @param guardBytes location to store the size of the guard at the bottom of the allocation (0 if none)
+ *      @return void* address to base of the allocated space, the guard included
+ **/
+void * mallocStackFromHeap(uint32_t size_in_bytes, uint32_t *guardBytes)
+{
+#if SINGLE_REGION_STACKS
+    uint32_t size = roundUpPowerOfTwo(size_in_bytes < 32 ? 32 : size_in_bytes);
+
+    *guardBytes = 0;
+#if STACK_GUARD
+    if (size >= 256 && size_in_bytes + size / SUBREGIONS_PER_REGION > size)     size <<= 1;     // Guard does not fit in the slack
+    if (size >= 256)    *guardBytes = size / SUBREGIONS_PER_REGION;                 // Smaller regions have no subregions
+#endif
+    return mallocAlignedFromHeap(size);
+#else
+    uint32_t guard = 0;
+    uint16_t blockSize;
+    uint8_t i;
+    void *address;
+
+#if STACK_GUARD
+    guard = heapRegions_g[0].blockSize;
+    for (i = 1; i < heapRegionCount_g; i++)                                         // Try the smallest subregion first
+    {
+        if (heapRegions_g[i].blockSize < guard)     guard = heapRegions_g[i].blockSize;
+    }
+#endif
+
+    while (true)
+    {
+        address = mallocFromHeap(size_in_bytes + guard);
+        if (address == NULL || !guard)  break;
+
+        blockSize = heapRegions_g[getLedgerIndex((uintptr_t)address) / SUBREGIONS_PER_REGION].blockSize;
+        if (blockSize <= guard)                                                     // The bottom subregion fits the room left for it
+        {
+            guard = blockSize;
+            break;
+        }
+
+        freeToHeap(address);                                                        // Retry with room for the larger subregion
+        guard = blockSize;
+    }
+
+    *guardBytes = guard;
+    return address;
+#endif
+}
+
+/**
+ *      @brief Function to return an allocation to the heap
+ *              Clears its subregions in the ledger and drops its metadata entry, so the space can be handed out again at once
+ *      @param address base of the allocation, as returned by the allocator
+ *      @return true if the allocation was found and released
+ **/
+bool freeToHeap(void *address)
+{
+    uint8_t i, index;
+
+    for (i = 0; i < heapTop_g; i++)
+    {
+        if (heapMetadata_g[i].address != address)   continue;
+
+        index = getLedgerIndex((uintptr_t)address);
+        heapLedger_g &= ~LEDGER_RANGE(index, index + heapMetadata_g[i].subRegions - 1);
+
+        heapMetadata_g[i] = heapMetadata_g[--heapTop_g];                            // Move the last entry into the hole
+        return true;
+    }
+    return false;
+}
+
 /**
 *      @brief Function to enable MPU
 **/
@@ -243,17 +434,21 @@ void allowFlashAccess(void)
 /**
  *      @brief Function to set access rules for the SRAM region
  *              Shareable, Cacheable
- *      Region Map
+ *              SRAM is privileged only, tasks are given access to their own stacks on top of it
+ *      Region Map (default sramConfig.h)
  *      | Region | Start Addr | End Addr   | AP  |
  *      |--------|------------|------------|-----|
  *      | Base   | 0x00000000 | 0xFFFFFFFF | 011 |
  *      | Flash  | 0x00000000 | 0x0003FFFF | 011 |
- *      | OS+GV  | 0x20000000 | 0x20000FFF | 001 |
+ *      | SRAM   | 0x20000000 | 0x20007FFF | 001 |
+ *      SRD stacks, one region per heap region with subregions enabled per task
  *      | 4K-1   | 0x20001000 | 0x20001FFF | 011 |
  *      | 8K-1   | 0x20002000 | 0x20003FFF | 011 |
  *      | 4K-2   | 0x20004000 | 0x20004FFF | 011 |
  *      | 4K-3   | 0x20005000 | 0x20005FFF | 011 |
  *      | 8K-2   | 0x20006000 | 0x20007FFF | 011 |
+ *      Single region stacks, one region moved to the stack of the running task
+ *      | Task   | stack      | stack+size | 011 |
  **/
 void setupSramAccess(void)
 {
@@ -263,7 +458,7 @@ void setupSramAccess(void)
 #ifndef UPDATE_SRAM_MPU_RULES
 #define UPDATE_SRAM_MPU_RULES(regionNumber, address, privilege, srd, size)                          \
     ({                                                                                              \
-        NVIC_MPU_NUMBER_R   = MPU_SRAM_##regionNumber;              /* Set SRAM region number */    \
+        NVIC_MPU_NUMBER_R   = regionNumber;                         /* Set SRAM region number */    \
         NVIC_MPU_BASE_R     = address;                              /* SRAM address */              \
         NVIC_MPU_ATTR_R     = NVIC_MPU_ATTR_XN;                     /* Enable execute never */      \
         NVIC_MPU_ATTR_R     |= NVIC_MPU_ATTR_##privilege;           /* Privileged access */         \
@@ -271,16 +466,20 @@ void setupSramAccess(void)
         NVIC_MPU_ATTR_R     |= NVIC_MPU_ATTR_SHAREABLE;             /* Shareable */                 \
         NVIC_MPU_ATTR_R     |= NVIC_MPU_ATTR_CACHEABLE;             /* Cacheable */                 \
         NVIC_MPU_ATTR_R     |= srd;                                 /* Disable sub-regions */       \
-        NVIC_MPU_ATTR_R     |= NVIC_MPU_ATTR_SIZE_SRAM_##size;      /* Apply rules  */              \
+        NVIC_MPU_ATTR_R     |= NVIC_MPU_ATTR_SIZE(size);            /* Apply rules  */              \
         NVIC_MPU_ATTR_R     |= NVIC_MPU_ATTR_ENABLE;                /* Enable region */             \
     })
 
-    UPDATE_SRAM_MPU_RULES(OS, REGION_4K0_BASE_ADDR, AP_K, 0, 4K);                       // SRAM base   0 => 4K starting from 0x20000000
-    UPDATE_SRAM_MPU_RULES(4K1, REGION_4K1_BASE_ADDR, AP_F, NVIC_MPU_ATTR_SRD_M, 4K);    // SRAM Region 1 => 4K starting from 0x20001000
-    UPDATE_SRAM_MPU_RULES(8K1, REGION_8K1_BASE_ADDR, AP_F, NVIC_MPU_ATTR_SRD_M, 8K);    // SRAM Region 2 => 8K starting from 0x20002000
-    UPDATE_SRAM_MPU_RULES(4K2, REGION_4K2_BASE_ADDR, AP_F, NVIC_MPU_ATTR_SRD_M, 4K);    // SRAM Region 3 => 4K starting from 0x20004000
-    UPDATE_SRAM_MPU_RULES(4K3, REGION_4K3_BASE_ADDR, AP_F, NVIC_MPU_ATTR_SRD_M, 4K);    // SRAM Region 4 => 4K starting from 0x20005000
-    UPDATE_SRAM_MPU_RULES(8K2, REGION_8K2_BASE_ADDR, AP_F, NVIC_MPU_ATTR_SRD_M, 8K);    // SRAM Region 5 => 8K starting from 0x20006000
+    UPDATE_SRAM_MPU_RULES(MPU_SRAM_OS, SRAM_BASE_ADDR, AP_K, 0, SRAM_SIZE);            // All of SRAM, privileged only
+
+#if !SINGLE_REGION_STACKS
+    uint8_t i;
+
+    for (i = 0; i < heapRegionCount_g; i++)                                             // One region per heap region, all subregions disabled
+    {
+        UPDATE_SRAM_MPU_RULES(MPU_SRAM_HEAP + i, heapRegions_g[i].baseAddr, AP_F, NVIC_MPU_ATTR_SRD_M, heapRegions_g[i].size);
+    }
+#endif
 
 #undef UPDATE_SRAM_MPU_RULES
 #endif
@@ -303,26 +502,17 @@ uint8_t getMask(uint8_t subRegionCount, uint8_t subRegionStart)
 
 /**
 *      @brief Enable the necessary subregions for the task
+*              Every heap region is rewritten so nothing enabled for the previous task stays enabled
 *      @param subRegionMap the subregion map for the task
 **/
 void applySrdRules(uint8_t *subRegionMap)
 {
     uint8_t i;
-    uint32_t mask;
-    for (i = MPU_SRAM_4K1; i < (MPU_SRAM_4K1 + NUM_SRAM_REGIONS); i++)
+    for (i = MPU_SRAM_HEAP; i < (MPU_SRAM_HEAP + heapRegionCount_g); i++)
     {
-        mask = subRegionMap[i - MPU_SRAM_4K1];                  // Get the SRD bits locally
-
-        if (mask)                                               // Generate the Mask only if SRD is non-empty
-        {
-            mask <<= 8;                                         // Move bits to position of SRD within register
-            mask |= 0xFF;                                       // So as to not change the lower 8 bits
-            mask |= (uint32_t)(0xFFFF << 16);                   // So as to not change the upper 16 bits
-
-            NVIC_MPU_NUMBER_R   = i;                            // Set SRAM region number
-            NVIC_MPU_ATTR_R     |= NVIC_MPU_ATTR_AP_F;          // Privileged access
-            NVIC_MPU_ATTR_R     &= mask;                        // Enable sub-regions
-        }
+        NVIC_MPU_NUMBER_R   = i;                                                        // Set SRAM region number
+        NVIC_MPU_ATTR_R     = (NVIC_MPU_ATTR_R & ~NVIC_MPU_ATTR_SRD_M)                  // Replace the sub-region disable bits
+                            | ((uint32_t)subRegionMap[i - MPU_SRAM_HEAP] << 8);
     }
 }
 
@@ -336,8 +526,8 @@ void applySrdRules(uint8_t *subRegionMap)
 **/
 uint8_t getSubRegions(uint32_t baseAdd, uint32_t regionAdd, uint32_t size_in_bytes, uint16_t minBlockSize)
 {
-    uint8_t subRegionStart = ((uint32_t)baseAdd - regionAdd) / minBlockSize;    // Determine start of the subregions to enable
-    uint8_t subRegionCount = size_in_bytes / minBlockSize;                      // Get the number of subregions to enable
+    uint8_t subRegionStart = ((uintptr_t)baseAdd - regionAdd) / minBlockSize;    // Determine start of the subregions to enable
+    uint8_t subRegionCount = (size_in_bytes + minBlockSize - 1) / minBlockSize; // Get the number of subregions to enable
 
     return (getMask(subRegionCount, subRegionStart));
 }
@@ -345,50 +535,235 @@ uint8_t getSubRegions(uint32_t baseAdd, uint32_t regionAdd, uint32_t size_in_byt
 /**
  *      @brief Function ot generate the SRD mask for the requested task
  *              This depends on the memory allocation and is specific for each task
- *              Determine the region within SRAM where
- *              1.5K region @ 0x20001E00
- *              1.5K region @ 0x20003C00
- *              1.5K region @ 0x20005E00
- *              Region 1 => 4K
- *              Region 2 => 8K
- *              Region 3 => 4K
- *              Region 4 => 4K
- *              Region 5 => 8K
+ *              Every heap region overlapped by the allocation gets the mask of the overlapping subregions,
+ *              so allocations straddling a region boundary enable subregions in both regions
  *      @param baseAdd Base address of the allocated region
  *      @param size_in_bytes number of bytes allocated
  *      @param subRegionMap location to store the subregion mask
  **/
 void generateSrdMasks(uint32_t *baseAdd, uint32_t size_in_bytes, uint8_t *subRegionMap)
 {
-    if ((uint32_t)baseAdd == 0x20001E00)
+    uint32_t start = (uintptr_t)baseAdd, end = (uintptr_t)baseAdd + size_in_bytes;
+    uint32_t from, to;
+    uint8_t i;
+
+    for (i = 0; i < heapRegionCount_g; i++)
+    {
+        from = (start > heapRegions_g[i].baseAddr) ? start : heapRegions_g[i].baseAddr;
+        to = (end < heapRegions_g[i].baseAddr + heapRegions_g[i].size) ? end : heapRegions_g[i].baseAddr + heapRegions_g[i].size;
+
+        if (from < to)  subRegionMap[i] = getSubRegions(from, heapRegions_g[i].baseAddr, to - from, heapRegions_g[i].blockSize);
+        else            subRegionMap[i] = (uint8_t)(NVIC_MPU_ATTR_SRD_M >> 8);                  // No access in this region
+    }
+}
+
+/**
+ *      @brief Function to generate the MPU settings of a task from its stack allocation
+ *              A guard disables the lowest subregion of the allocation, so a stack running off its bottom
+ *              falls into the privileged SRAM region and faults instead of corrupting a neighbour
+ *      @param baseAdd Base address of the stack allocation
+ *      @param size_in_bytes number of bytes allocated, the guard included
+ *      @param guardBytes size of the guard set by mallocStackFromHeap, one subregion or 0 for none
+ *      @param mpu location to store the MPU settings
+ **/
+void generateTaskMpu(void *baseAdd, uint32_t size_in_bytes, uint32_t guardBytes, taskMpu_t *mpu)
+{
+#if SINGLE_REGION_STACKS
+    uint32_t size = roundUpPowerOfTwo(size_in_bytes);
+    if (size < 32)  size = 32;                                                      // Smallest MPU region
+
+    mpu->stackBase  = (uintptr_t)baseAdd | NVIC_MPU_BASE_VALID | MPU_SRAM_TASK;      // Select the region with the address
+    mpu->stackAttr  = NVIC_MPU_ATTR_XN | NVIC_MPU_ATTR_AP_F | NVIC_MPU_ATTR_TEX_N
+                    | NVIC_MPU_ATTR_SHAREABLE | NVIC_MPU_ATTR_CACHEABLE
+                    | NVIC_MPU_ATTR_SIZE(size) | NVIC_MPU_ATTR_ENABLE;
+
+    if (guardBytes)     mpu->stackAttr |= (1 << 8);                                 // Disable subregion 0
+#else
+    uint8_t i;
+
+    generateSrdMasks(baseAdd, size_in_bytes, mpu->srd);
+
+    for (i = 0; guardBytes && i < heapRegionCount_g; i++)                           // Region holding the bottom of the stack
+    {
+        if ((uintptr_t)baseAdd < heapRegions_g[i].baseAddr || (uintptr_t)baseAdd >= heapRegions_g[i].baseAddr + heapRegions_g[i].size)    continue;
+
+        mpu->srd[i]    |= 1 << (((uintptr_t)baseAdd - heapRegions_g[i].baseAddr) / heapRegions_g[i].blockSize);
+        break;
+    }
+#endif
+    mpu->guardSize  = guardBytes;
+#if CONFIG_SHARED_MEMORY
+    mpu->windowCount = 0;                                                           // No shared memory attached yet
+#endif
+}
+
+/**
+ *      @brief Function to apply the MPU settings of the task about to run
+ *              Single region stacks cost one region write, SRD stacks one write per heap region
+ *      @param mpu the MPU settings of the task
+ **/
+void applyTaskMpu(taskMpu_t *mpu)
+{
+#if SINGLE_REGION_STACKS
+#if CONFIG_SHARED_MEMORY
+    uint8_t i;
+#endif
+
+    NVIC_MPU_BASE_R = mpu->stackBase;                                               // Move the task region to the stack
+    NVIC_MPU_ATTR_R = mpu->stackAttr;
+
+#if CONFIG_SHARED_MEMORY
+    for (i = 0; i < mpu->windowCount || i < windowsLoaded_g; i++)                   // Windows of this task or left by the last one
     {
-        subRegionMap[MPU_SRAM_4K1 - 3] = getSubRegions((uint32_t)0x20001E00, REGION_4K1_BASE_ADDR, 512, BLOCK_SIZE_1);
-        subRegionMap[MPU_SRAM_8K1 - 3] = getSubRegions((uint32_t)0x20002000, REGION_8K1_BASE_ADDR, 1024, BLOCK_SIZE_2);
+        NVIC_MPU_BASE_R = (i < mpu->windowCount) ? mpu->windowBase[i] : (NVIC_MPU_BASE_VALID | (uint32_t)(MPU_SRAM_WINDOW + i));
+        NVIC_MPU_ATTR_R = (i < mpu->windowCount) ? mpu->windowAttr[i] : 0;          // Disable unused windows
     }
+    windowsLoaded_g = mpu->windowCount;
+#endif
+#else
+    applySrdRules(mpu->srd);
+#endif
+}
 
-    else if ((uint32_t)baseAdd == 0x20003C00)
+#if CONFIG_SHARED_MEMORY
+/**
+ *      @brief Function to create a named shared memory object
+ *              The object is a naturally aligned power of two block so that one MPU region maps it into a task
+ *              Must be called with privileges, before the tasks that attach to it run
+ *      @param name of the object, at most SHARED_MEMORY_NAME_LENGTH - 1 characters
+ *      @param size_in_bytes size of the object, rounded up to a power of two
+ *      @return true if the object was created
+ *      @return false if there is no memory, or the name is taken or too long
+ **/
+bool createSharedMemory(const char name[], uint32_t size_in_bytes)
+{
+    uint8_t i;
+    void *address;
+
+    if (sharedMemoryCount_g >= MAX_SHARED_MEMORY)   return false;
+
+    for (i = 0; name[i]; i++)
     {
-        subRegionMap[MPU_SRAM_8K1 - 3] = getSubRegions((uint32_t)0x20003C00, REGION_8K1_BASE_ADDR, 1024, BLOCK_SIZE_2);
-        subRegionMap[MPU_SRAM_4K2 - 3] = getSubRegions((uint32_t)0x20004000, REGION_4K2_BASE_ADDR, 512, BLOCK_SIZE_1);
+        if (i >= (SHARED_MEMORY_NAME_LENGTH - 1))   return false;                   // Not cut, a shorter name could match another object
     }
 
-    else if ((uint32_t)baseAdd == 0x20005E00)
+    for (i = 0; i < sharedMemoryCount_g; i++)
     {
-        subRegionMap[MPU_SRAM_4K3 - 3] = getSubRegions((uint32_t)0x20005E00, REGION_4K3_BASE_ADDR, 512, BLOCK_SIZE_1);
-        subRegionMap[MPU_SRAM_8K2 - 3] = getSubRegions((uint32_t)0x20006000, REGION_8K2_BASE_ADDR, 1024, BLOCK_SIZE_2);
+        if (!strcmp(sharedMemory_g[i].name, name))  return false;                   // Names must be unique
     }
 
-    else if ((uint32_t)baseAdd < REGION_4K1_TOP_ADDR)   subRegionMap[MPU_SRAM_4K1 - 3] = getSubRegions((uint32_t)baseAdd, REGION_4K1_BASE_ADDR, size_in_bytes, BLOCK_SIZE_1);
-    else if ((uint32_t)baseAdd < REGION_8K1_TOP_ADDR)   subRegionMap[MPU_SRAM_8K1 - 3] = getSubRegions((uint32_t)baseAdd, REGION_8K1_BASE_ADDR, size_in_bytes, BLOCK_SIZE_2);
-    else if ((uint32_t)baseAdd < REGION_4K2_TOP_ADDR)   subRegionMap[MPU_SRAM_4K2 - 3] = getSubRegions((uint32_t)baseAdd, REGION_4K2_BASE_ADDR, size_in_bytes, BLOCK_SIZE_1);
-    else if ((uint32_t)baseAdd < REGION_4K3_TOP_ADDR)   subRegionMap[MPU_SRAM_4K3 - 3] = getSubRegions((uint32_t)baseAdd, REGION_4K3_BASE_ADDR, size_in_bytes, BLOCK_SIZE_1);
-    else if ((uint32_t)baseAdd < REGION_8K2_TOP_ADDR)   subRegionMap[MPU_SRAM_8K2 - 3] = getSubRegions((uint32_t)baseAdd, REGION_8K2_BASE_ADDR, size_in_bytes, BLOCK_SIZE_2);
+    address = mallocAlignedFromHeap(size_in_bytes);
+    if (address == NULL)    return false;
+
+    sharedMemory_g[sharedMemoryCount_g].address = address;
+    sharedMemory_g[sharedMemoryCount_g].size = roundUpPowerOfTwo(size_in_bytes < 32 ? 32 : size_in_bytes);
+    strcpy(sharedMemory_g[sharedMemoryCount_g].name, name);
+    sharedMemoryCount_g++;
+
+    return true;
+}
+
+/**
+ *      @brief Function to map a shared memory object into the MPU settings of a task
+ *              The window is added as an extra MPU region, other memory stays out of reach of the task
+ *      @param mpu the MPU settings of the task
+ *      @param name of the object
+ *      @param writable true for read-write access, false for read-only
+ *      @return void* address of the object, NULL if it does not exist or no window is free
+ **/
+void *attachWindow(taskMpu_t *mpu, const char name[], bool writable)
+{
+#if SINGLE_REGION_STACKS
+    uint8_t i, window;
+    uint32_t base;
+
+    for (i = 0; i < sharedMemoryCount_g; i++)
+    {
+        if (strcmp(sharedMemory_g[i].name, name))   continue;
+
+        base = (uintptr_t)sharedMemory_g[i].address;
+        for (window = 0; window < mpu->windowCount; window++)                       // Already attached, update the access
+        {
+            if ((mpu->windowBase[window] & NVIC_MPU_BASE_ADDR_M) == base)   break;
+        }
+
+        if (window >= MAX_TASK_WINDOWS)     return NULL;                            // All windows are in use
+
+        mpu->windowBase[window] = base | NVIC_MPU_BASE_VALID | (MPU_SRAM_WINDOW + window);
+        mpu->windowAttr[window] = NVIC_MPU_ATTR_XN | (writable ? NVIC_MPU_ATTR_AP_F : NVIC_MPU_ATTR_AP_R)
+                                | NVIC_MPU_ATTR_TEX_N | NVIC_MPU_ATTR_SHAREABLE | NVIC_MPU_ATTR_CACHEABLE
+                                | NVIC_MPU_ATTR_SIZE(sharedMemory_g[i].size) | NVIC_MPU_ATTR_ENABLE;
+        if (window == mpu->windowCount)     mpu->windowCount++;
+
+        return sharedMemory_g[i].address;
+    }
+#endif
+    return NULL;
 }
+#endif
 
-void initMpu(void)
+/**
+ *      @brief Function to build the heap region map and enable the MPU rules
+ *      @return true if the MPU is enabled
+ *      @return false if sramConfig.h does not fit the linker placed heap (the MPU is left disabled)
+ **/
+bool initMpu(void)
 {
+    if (!initHeapRegions())     return false;                                       // Heap and stack rules would cover the wrong memory
+
     setBackgroundRules();
     allowFlashAccess();
     setupSramAccess();
     enableMPU();
+    return true;
+}
+
+/**
+ *      @brief Function to snapshot the heap ledger and allocations for the meminfo command
+ *              Only copies state, so it is safe to call from a service call; owners other than
+ *              shared memory objects are left as "kernel" for the caller to fill in
+ *      @param info location to store the snapshot
+ **/
+void getHeapInfo(heapInfo_t *info)
+{
+    uint8_t i, j, run, index;
+
+    info->regionCount = heapRegionCount_g;
+    for (i = 0; i < heapRegionCount_g; i++)
+    {
+        info->regions[i].baseAddr       = heapRegions_g[i].baseAddr;
+        info->regions[i].blockSize      = heapRegions_g[i].blockSize;
+        info->regions[i].used           = (uint8_t)(heapLedger_g >> (i * SUBREGIONS_PER_REGION));
+        info->regions[i].freeBytes      = 0;
+        info->regions[i].largestFree    = 0;
+
+        for (j = 0, run = 0; j < SUBREGIONS_PER_REGION; j++)                        // Count free subregions and the longest run
+        {
+            run = (info->regions[i].used & (1 << j)) ? 0 : run + 1;
+            if (run)    info->regions[i].freeBytes += heapRegions_g[i].blockSize;
+            if (run * heapRegions_g[i].blockSize > info->regions[i].largestFree)     info->regions[i].largestFree = run * heapRegions_g[i].blockSize;
+        }
+    }
+
+    info->allocationCount = heapTop_g;
+    for (i = 0; i < heapTop_g; i++)
+    {
+        info->allocations[i].address    = (uintptr_t)heapMetadata_g[i].address;
+        info->allocations[i].size       = 0;
+        strcpy(info->allocations[i].owner, "kernel");
+
+        index = getLedgerIndex(info->allocations[i].address);                       // Ledger index of the first subregion
+
+        for (j = 0; j < heapMetadata_g[i].subRegions; j++)                          // Runs may straddle regions of different block sizes
+        {
+            info->allocations[i].size += heapRegions_g[(index + j) / SUBREGIONS_PER_REGION].blockSize;
+        }
+
+#if CONFIG_SHARED_MEMORY
+        for (j = 0; j < sharedMemoryCount_g; j++)
+        {
+            if (sharedMemory_g[j].address == heapMetadata_g[i].address)     strcpy(info->allocations[i].owner, sharedMemory_g[j].name);
+        }
+#endif
+    }
 }
@@ -11,15 +11,120 @@
 #ifndef MM_H_
 #define MM_H_
 
-#define NUM_SRAM_REGIONS 5
+#include <stdint.h>
+#include <stdbool.h>
+#include "sramConfig.h"
+#include "kernelConfig.h"
+
+#define NUM_SRAM_REGIONS HEAP_REGION_COUNT
+
+#if (NUM_SRAM_REGIONS < 1) || (NUM_SRAM_REGIONS > 5)
+#error "HEAP_REGION_COUNT must be between 1 and 5 (MPU regions 3 to 7)"
+#endif
+
+#define MAX_TASK_WINDOWS            4               // Shared memory windows per task (MPU regions 4 to 7, single region stacks only)
+#define SHARED_MEMORY_NAME_LENGTH   10              // Maximum length of a shared memory name (including terminator)
+
+// MPU settings applied when a task is dispatched
+typedef struct _taskMpu
+{
+    uint8_t srd[NUM_SRAM_REGIONS];                  // Subregion disable bits of each heap region (SRD stacks)
+    uint32_t stackBase;                             // Base register value of the stack region (single region stacks)
+    uint32_t stackAttr;                             // Attribute register value of the stack region (single region stacks)
+    uint32_t guardSize;                             // Bytes of no-access guard at the bottom of the allocation
+#if CONFIG_SHARED_MEMORY
+    uint8_t windowCount;                            // Number of shared memory windows attached
+    uint32_t windowBase[MAX_TASK_WINDOWS];          // Base register values of the shared memory windows
+    uint32_t windowAttr[MAX_TASK_WINDOWS];          // Attribute register values of the shared memory windows
+#endif
+} taskMpu_t;
+
+/**
+*      @brief Structure to hold the metadata of the Heap
+**/
+typedef struct
+{
+    void *address;                                              // Base of the allocation
+    uint8_t subRegions;                                         // Number of subregions allocated here
+} heapMetadata_t;
+
+#if CONFIG_SHARED_MEMORY
+/**
+*      @brief Structure to hold a named shared memory object
+**/
+typedef struct
+{
+    void *address;                                              // Base of the object, aligned to its size
+    uint32_t size;                                              // Size of the object (power of two)
+    char name[SHARED_MEMORY_NAME_LENGTH];                       // Name used to attach to the object
+} sharedMemory_t;
+#endif
+
+/**
+*      @brief Structure to describe one MPU region of the heap
+*               Ledger bits (index * 8) to (index * 8 + 7) track the subregions of the region at position index
+**/
+typedef struct
+{
+    uint32_t baseAddr;                                          // Base address of the region
+    uint32_t size;                                              // Size of the region
+    uint16_t blockSize;                                         // Size of each of the 8 subregions
+    uint64_t window;                                            // Ledger bits that allocations local to this region may occupy
+} heapRegion_t;
+
+// Kernel SRAM taken by the memory manager tables, counted by the kernel SRAM budget check in kernel.c
+#if CONFIG_SHARED_MEMORY
+#define SHARED_MEMORY_SRAM_BYTES    (MAX_SHARED_MEMORY * sizeof(sharedMemory_t))
+#else
+#define SHARED_MEMORY_SRAM_BYTES    0
+#endif
+#define MM_SRAM_BYTES               (NUM_SRAM_REGIONS * (sizeof(heapRegion_t) + 8 * sizeof(heapMetadata_t) + sizeof(uint64_t)) \
+                                     + SHARED_MEMORY_SRAM_BYTES)
+
+// Snapshot of one heap region for the meminfo command
+typedef struct
+{
+    uint32_t baseAddr;                              // Base address of the region
+    uint16_t blockSize;                             // Size of each subregion
+    uint8_t used;                                   // Ledger bits of the region (1 = allocated)
+    uint32_t freeBytes;                             // Free bytes in the region
+    uint32_t largestFree;                           // Largest run of free subregions in bytes
+} regionInfo_t;
+
+// Snapshot of one heap allocation for the meminfo command
+typedef struct
+{
+    uint32_t address;                               // Base of the allocation
+    uint32_t size;                                  // Bytes covered by its subregions
+    char owner[16];                                 // Task or shared memory object using it
+} allocationInfo_t;
+
+// Snapshot of the heap for the meminfo command
+typedef struct
+{
+    uint8_t regionCount;
+    uint8_t allocationCount;
+    regionInfo_t regions[NUM_SRAM_REGIONS];
+    allocationInfo_t allocations[NUM_SRAM_REGIONS * 8];
+} heapInfo_t;
 
 //-----------------------------------------------------------------------------
 // Subroutines
 //-----------------------------------------------------------------------------
 
 void * mallocFromHeap(uint32_t size_in_bytes);
+void * mallocAlignedFromHeap(uint32_t size_in_bytes);
+void * mallocStackFromHeap(uint32_t size_in_bytes, uint32_t *guardBytes);
+bool freeToHeap(void *address);
 void generateSrdMasks(uint32_t *baseAdd, uint32_t size_in_bytes, uint8_t *subRegionMap);
 void applySrdRules(uint8_t *subRegionMap);
-void initMpu(void);
+void generateTaskMpu(void *baseAdd, uint32_t size_in_bytes, uint32_t guardBytes, taskMpu_t *mpu);
+void applyTaskMpu(taskMpu_t *mpu);
+#if CONFIG_SHARED_MEMORY
+bool createSharedMemory(const char name[], uint32_t size_in_bytes);
+void *attachWindow(taskMpu_t *mpu, const char name[], bool writable);
+#endif
+void getHeapInfo(heapInfo_t *info);
+bool initMpu(void);
 
 #endif
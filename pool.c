@@ -0,0 +1,199 @@
+/**
+*      @file pool.c
+*      @author Prithvi Bhat
+*      @brief Fixed-block memory pools with O(1) allocation and release
+*               Blocks are handed out from a free list threaded through the blocks themselves
+*               Every list update is done with interrupts masked so pools may be shared with ISRs
+*               Unprivileged tasks cannot mask interrupts and go through a service call instead
+**/
+
+#include <stdint.h>
+#include "pool.h"
+#include "strings.h"
+#include "systemRegisters.h"
+
+#if CONFIG_POOLS
+
+#define NULL    0x00000000
+
+// Global variables
+pool_t *pools_g[MAX_POOLS];                                                     // Registered pools
+uint8_t poolCount_g = 0;                                                        // Number of registered pools
+
+/**
+*      @brief Function to carve a block of memory into a pool of fixed size blocks
+*      @param pool to be initialised
+*      @param name of the pool, cut to POOL_NAME_LENGTH - 1 characters
+*      @param storage memory backing the pool, at least POOL_STORAGE_BYTES(blockSize, blockCount) bytes, word aligned
+*               It must be accessible to every task that allocates from the pool
+*      @param blockSize size of each block in bytes (rounded up to a multiple of 4)
+*      @param blockCount number of blocks in the pool
+*      @return true if the pool was initialised and registered
+*      @return false if the arguments are invalid or too many pools exist
+**/
+bool initPool(pool_t *pool, const char name[], void *storage, uint16_t blockSize, uint16_t blockCount)
+{
+    uint16_t i;
+    uint8_t *block;
+
+    if (!storage || !blockCount || ((uint32_t)storage & 3) || poolCount_g >= MAX_POOLS)    return false;
+
+    blockSize = (blockSize < sizeof(void *)) ? sizeof(void *) : ((blockSize + 3) & ~3);  // Every block must hold a list link
+
+    pool->storage       = (uint8_t *)storage;
+    pool->blockSize     = blockSize;
+    pool->blockCount    = blockCount;
+    pool->used          = 0;
+    pool->highWater     = 0;
+    pool->freeList      = storage;
+    pool->allocated     = (uint32_t *)(pool->storage + (uint32_t)blockSize * blockCount);
+
+    for (i = 0; i < (POOL_NAME_LENGTH - 1) && name[i]; i++)                     // Store name, cut to the field
+    {
+        pool->name[i] = name[i];
+    }
+    pool->name[i] = '\0';
+
+    for (i = 0; i < (blockCount + 31) / 32; i++)                                // Every block starts free
+    {
+        pool->allocated[i] = 0;
+    }
+
+    block = pool->storage;
+    for (i = 0; i < (blockCount - 1); i++)                                      // Link each block to the one above it
+    {
+        *(void **)block = block + blockSize;
+        block += blockSize;
+    }
+    *(void **)block = NULL;                                                     // Terminate the list
+
+    pools_g[poolCount_g++] = pool;                                              // Register for the pools command
+    return true;
+}
+
+/**
+*      @brief Function to take a block off the free list
+*               Must be called with privileges (handler mode or kernel)
+*      @param pool to allocate from
+*      @return void* address of the block, NULL if the pool is exhausted
+**/
+void *takeBlock(pool_t *pool)
+{
+    uint32_t primask = disableInterrupts();                                     // Keep ISRs out of the list
+    void *block = pool->freeList;
+    uint32_t index;
+
+    if (block)
+    {
+        index = ((uint8_t *)block - pool->storage) / pool->blockSize;
+        pool->allocated[index / 32] |= (uint32_t)1 << (index % 32);             // Mark it handed out
+        pool->freeList = *(void **)block;                                       // Unlink the first free block
+        if (++pool->used > pool->highWater)     pool->highWater = pool->used;   // Track the high-water mark
+    }
+
+    restoreInterrupts(primask);
+    return block;
+}
+
+/**
+*      @brief Function to return a block to the free list
+*               Must be called with privileges (handler mode or kernel)
+*      @param pool the block was allocated from
+*      @param block to be released, ignored if it does not belong to the pool or is already free
+**/
+void giveBlock(pool_t *pool, void *block)
+{
+    uint32_t offset = (uint32_t)block - (uint32_t)pool->storage;
+    uint32_t index = offset / pool->blockSize;
+    uint32_t mask = (uint32_t)1 << (index % 32);
+    uint32_t primask;
+
+    if (offset >= ((uint32_t)pool->blockSize * pool->blockCount) || (offset % pool->blockSize))   return;
+
+    primask = disableInterrupts();                                              // Keep ISRs out of the list
+    if (!(pool->allocated[index / 32] & mask))                                  // Double free, the list must not loop
+    {
+        restoreInterrupts(primask);
+        return;
+    }
+    pool->allocated[index / 32] &= ~mask;
+    *(void **)block = pool->freeList;                                           // Push the block onto the list
+    pool->freeList = block;
+    pool->used--;
+    restoreInterrupts(primask);
+}
+
+/**
+*      @brief Service call to allocate a block on behalf of an unprivileged task
+*      @param pool to allocate from
+*      @param block location to store the address of the block
+**/
+void requestBlock(pool_t *pool, void **block)
+{
+    __asm(" SVC #0x19");                                    // Trigger a Service call
+}
+
+/**
+*      @brief Service call to release a block on behalf of an unprivileged task
+*      @param pool the block was allocated from
+*      @param block to be released
+**/
+void releaseBlock(pool_t *pool, void *block)
+{
+    __asm(" SVC #0x1A");                                    // Trigger a Service call
+}
+
+/**
+*      @brief Function to allocate a block from a pool
+*               Safe to call from tasks and ISRs
+*      @param pool to allocate from
+*      @return void* address of the block, NULL if the pool is exhausted
+**/
+void *poolAlloc(pool_t *pool)
+{
+    void *block = NULL;
+
+    if (IN_PRIVILEGED_CONTEXT())    block = takeBlock(pool);
+    else                            requestBlock(pool, &block);
+
+    return block;
+}
+
+/**
+*      @brief Function to release a block back to its pool
+*               Safe to call from tasks and ISRs
+*      @param pool the block was allocated from
+*      @param block to be released
+**/
+void poolFree(pool_t *pool, void *block)
+{
+    if (IN_PRIVILEGED_CONTEXT())    giveBlock(pool, block);
+    else                            releaseBlock(pool, block);
+}
+
+/**
+*      @brief Function to copy the state of every registered pool
+*      @param poolInfo array of MAX_POOLS entries, unused entries have a zero block count
+**/
+void getPoolInfo(poolInfo_t *poolInfo)
+{
+    uint8_t i;
+
+    for (i = 0; i < MAX_POOLS; i++)
+    {
+        if (i < poolCount_g)
+        {
+            poolInfo[i].blockSize   = pools_g[i]->blockSize;
+            poolInfo[i].blockCount  = pools_g[i]->blockCount;
+            poolInfo[i].used        = pools_g[i]->used;
+            poolInfo[i].highWater   = pools_g[i]->highWater;
+            strcpy(poolInfo[i].name, pools_g[i]->name);
+        }
+        else
+        {
+            poolInfo[i].blockCount  = 0;
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,56 @@
+/**
+*      @file pool.h
+*      @author Prithvi Bhat
+*      @brief Header file for fixed-block memory pools
+**/
+
+#ifndef POOL_H
+#define POOL_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include "kernelConfig.h"
+
+#define POOL_NAME_LENGTH    10          // Maximum length of a pool name (including terminator)
+
+/**
+*      @brief Structure to hold the state of a fixed-block pool
+*               Free blocks are linked through their first word, so no memory is spent on bookkeeping
+**/
+typedef struct
+{
+    void *freeList;                     // First free block, each free block holds the address of the next
+    uint8_t *storage;                   // Base of the memory backing the pool
+    uint32_t *allocated;                // One bit per block (1 = allocated), kept after the blocks
+    uint16_t blockSize;                 // Size of each block in bytes (multiple of 4)
+    uint16_t blockCount;                // Number of blocks in the pool
+    uint16_t used;                      // Number of blocks currently allocated
+    uint16_t highWater;                 // Largest number of blocks ever allocated at once
+    char name[POOL_NAME_LENGTH];        // Name of the pool used in the pools command
+} pool_t;
+
+/**
+*      @brief Structure to hold a snapshot of a pool for the pools command
+**/
+typedef struct
+{
+    uint16_t blockSize;
+    uint16_t blockCount;
+    uint16_t used;
+    uint16_t highWater;
+    char name[POOL_NAME_LENGTH];
+} poolInfo_t;
+
+// Bytes needed to back a pool, the blocks followed by the allocation bitmap
+#define POOL_STORAGE_BYTES(blockSize, blockCount)   ((((blockSize) + 3) & ~3) * (blockCount) + (((blockCount) + 31) / 32) * 4)
+
+bool initPool(pool_t *pool, const char name[], void *storage, uint16_t blockSize, uint16_t blockCount);
+void *poolAlloc(pool_t *pool);
+void poolFree(pool_t *pool, void *block);
+
+// Kernel side, called with privileges
+void *takeBlock(pool_t *pool);
+void giveBlock(pool_t *pool, void *block);
+void getPoolInfo(poolInfo_t *poolInfo);
+
+#endif
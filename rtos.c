@@ -39,6 +39,8 @@
 #include "faults.h"
 #include "tasks.h"
 #include "shell.h"
+#include "workers.h"
+#include "stackSizes.h"
 
 /**
  *      @brief Placeholder function to initialise everything on system start
@@ -46,36 +48,45 @@
  **/
 void main(void)
 {
-    bool ok;
+    bool ok, mpuOk;
 
     initSystemClockTo40Mhz();                                   // Initialize System clock
     initHw();                                                   // Initialize LEDs and buttons
     initUart0();                                                // Initialise console UART
     initSystemInterrupts();                                     // Initialise interrupts
-    initMpu();                                                  // Initialise MPU rules and regions
+    mpuOk = initMpu();                                          // Initialise MPU rules and regions
     initRtos();                                                 // Initialise the RTOS
 
     setUart0BaudRate(115200, 40e6);                             // Setup UART0 baud rate
 
+    if (!mpuOk)                                                 // No heap, so no thread can be created
+    {
+        putsUart0("sramConfig.h: heap regions must be powers of two, aligned to their size and inside the heap\r\n");
+        while(true);
+    }
+
     // Initialize mutexes and semaphores
     initMutex(resource);
     initSemaphore(keyPressed, 1);
     initSemaphore(keyReleased, 0);
     initSemaphore(flashReq, 5);
 
-    ok = createThread(idle, "Idle", 7, 512);                    // Add an Idle process at lowest priority
+    ok = createThread(idle, "Idle", NUM_PRIORITIES - 1, STACK_SIZE_IDLE);           // Add an Idle process at lowest priority
     // ok &= createThread(idleSomeMore, "idleSomeMore", 7, 512);   // Add an Idle process at lowest priority
 
     // Add other processes
-    ok &= createThread(lengthyFn, "LengthyFn", 6, 1024);        // Add a lengthy process at a relatively high priority
-    ok &= createThread(flash4Hz, "Flash4Hz", 4, 1024);          // Flash LED at 4Hz frequency
-    ok &= createThread(oneshot, "OneShot", 2, 1024);            // Toggle the Yellow LED once
-    ok &= createThread(readKeys, "ReadKeys", 6, 1024);          // Read the state of push button keys
-    ok &= createThread(debounce, "Debounce", 6, 1024);          // Something to prevent debouncing on key press
-    ok &= createThread(important, "Important", 0, 1024);        // Toggle LED at the highest priority
-    ok &= createThread(uncooperative, "Uncoop", 6, 1024);
-    ok &= createThread(errant, "Errant", 6, 1024);
-    ok &= createThread(shell, "Shell", 6, 4096);
+    ok &= createThread(lengthyFn, "LengthyFn", 6, STACK_SIZE_LENGTHYFN);            // Add a lengthy process at a relatively high priority
+    ok &= createThread(flash4Hz, "Flash4Hz", 4, STACK_SIZE_FLASH4HZ);               // Flash LED at 4Hz frequency
+    ok &= createThread(oneshot, "OneShot", 2, STACK_SIZE_ONESHOT);                  // Toggle the Yellow LED once
+    ok &= createThread(readKeys, "ReadKeys", 6, STACK_SIZE_READKEYS);               // Read the state of push button keys
+    ok &= createThread(debounce, "Debounce", 6, STACK_SIZE_DEBOUNCE);               // Something to prevent debouncing on key press
+    ok &= createThread(important, "Important", 0, STACK_SIZE_IMPORTANT);            // Toggle LED at the highest priority
+    ok &= createThread(uncooperative, "Uncoop", 6, STACK_SIZE_UNCOOPERATIVE);
+    ok &= createThread(errant, "Errant", 6, STACK_SIZE_ERRANT);
+    ok &= createThread(shell, "Shell", 6, STACK_SIZE_SHELL);
+#if CONFIG_WORKERS
+    ok &= initWorkers(2, 6, STACK_SIZE_WORKER);                                     // Run the jobs submitted by the shell
+#endif
 
     if(ok)      startRtos();                                    // Start up RTOS (never returns)
     else        while(true);
@@ -3,14 +3,49 @@
 #include "tm4c123gh6pm.h"
 #include "shell.h"
 #include "kernel.h"
+#include "pool.h"
+#include "mm.h"
+#include "trace.h"
+#include "workers.h"
+#include "tasks.h"
+#include "stackSizes.h"
 
 #define IS_COMMAND(string, count)       if(isCommand(&shellData, string, count))
 #define ASSERT(value)                   if(value >= 0)
 
+#define SHELL_CALL_BYTES                640         // Deepest call below shell() plus the switch frame, check against the ps Stack column
+
+/**
+*      @brief Replies of the listing commands, one command runs at a time so they share the same stack bytes
+*               Kept on the shell stack, the shell runs unprivileged and cannot reach kernel .bss
+**/
+typedef union
+{
+    struct
+    {
+        mutexInfo_t mutex[MAX_MUTEXES];
+        semaphoreInfo_t semaphore[MAX_SEMAPHORES];
+    } ipcs;
+    psInfo_t ps[MAX_TASKS];
+#if CONFIG_POOLS
+    poolInfo_t pools[MAX_POOLS];
+#endif
+    heapInfo_t meminfo;
+#if CONFIG_PERIODIC_TASKS
+    rtStatInfo_t rtstat[MAX_TASKS];
+#endif
+#if CONFIG_TRACE
+    traceChunk_t trace;
+#endif
+} shellReply_t;
+
+typedef char shellStackCheck[(sizeof(shellReply_t) + sizeof(shellData_t) + SHELL_CALL_BYTES <= STACK_SIZE_SHELL) ? 1 : -1];
+
 
 void shell(void)
 {
     shellData_t shellData = {0,};
+    shellReply_t reply;
 
     char dest[20];
 
@@ -35,7 +70,8 @@ void shell(void)
             else IS_COMMAND("sched", 2)
             {
                 char *scheduleState = getFieldString(&shellData, 1);        // Get arguments
-                priority(toBool(scheduleState));                            // Invoke function
+                toLower(scheduleState);
+                sched(scheduleState);                                       // Invoke function
                 putsUart0("\r\n\r\n");
                 yield();
             }
@@ -84,14 +120,14 @@ void shell(void)
 
             else IS_COMMAND("ipcs", 1)
             {
-                mutexInfo_t mutexInfo[1];
-                semaphoreInfo_t semaphoreInfo[3];
+                mutexInfo_t *mutexInfo = reply.ipcs.mutex;
+                semaphoreInfo_t *semaphoreInfo = reply.ipcs.semaphore;
 
                 ipcs((void *)mutexInfo, (void *)semaphoreInfo);                                                     // Invoke function
 
                 uint8_t i, j;
                 putsUart0("----Semaphore Arrays----\r\n");
-                for (i = 0; i < 3; i++)
+                for (i = 0; i < MAX_SEMAPHORES; i++)
                 {
                     putsUart0("\r\n-----------------------------------");
                     putsUart0("\r\n Semaphore    | ");
@@ -114,7 +150,7 @@ void shell(void)
                 }
 
                 putsUart0("\r\n\r\n----Mutex Arrays----\r\n");
-                for (i = 0; i < 1; i++)
+                for (i = 0; i < MAX_MUTEXES; i++)
                 {
                     putsUart0("\r\n-----------------------------------");
                     putsUart0("\r\n Mutex        | ");
@@ -152,6 +188,71 @@ void shell(void)
                 yield();
             }
 
+            else IS_COMMAND("threshold", 3)
+            {
+                uint32_t pid = (uint32_t)getFieldInteger(&shellData, 1);    // Get arguments
+                uint32_t threshold = (uint32_t)getFieldInteger(&shellData, 2); // Get arguments
+                setThreadThreshold((_fn)pid, threshold);                    // Invoke function
+                putsUart0("\r\n\r\n");
+                yield();
+            }
+
+#if CONFIG_CPU_BUDGETS
+            else IS_COMMAND("budget", 4)
+            {
+                uint32_t pid = (uint32_t)getFieldInteger(&shellData, 1);    // Get arguments
+                uint32_t budgetUs = (uint32_t)getFieldInteger(&shellData, 2); // Get arguments
+                char *suspendState = getFieldString(&shellData, 3);         // Get arguments
+                setThreadBudget((_fn)pid, budgetUs, toBool(suspendState));  // Invoke function
+                putsUart0("\r\n\r\n");
+                yield();
+            }
+#endif
+
+#if CONFIG_PRIORITY_AGING
+            else IS_COMMAND("aging", 3)
+            {
+                uint32_t pid = (uint32_t)getFieldInteger(&shellData, 1);    // Get arguments
+                char *agingState = getFieldString(&shellData, 2);           // Get arguments
+                setThreadAging((_fn)pid, toBool(agingState));               // Invoke function
+                putsUart0("\r\n\r\n");
+                yield();
+            }
+#endif
+
+#if CONFIG_STRIDE_SCHEDULER
+            else IS_COMMAND("tickets", 3)
+            {
+                uint32_t pid = (uint32_t)getFieldInteger(&shellData, 1);    // Get arguments
+                uint16_t tickets = (uint16_t)getFieldInteger(&shellData, 2); // Get arguments
+                setThreadTickets((_fn)pid, tickets);                        // Invoke function
+                putsUart0("\r\n\r\n");
+                yield();
+            }
+#endif
+
+#if CONFIG_WORKERS
+            else IS_COMMAND("job", 2)
+            {
+                uint32_t flashes = (uint32_t)getFieldInteger(&shellData, 1); // Get arguments
+                if (!submitJob(flashJob, (void *)flashes, NO_NOTIFY))       // Invoke function
+                {
+                    putsUart0("Job queue full");
+                }
+                putsUart0("\r\n\r\n");
+                yield();
+            }
+#endif
+
+            else IS_COMMAND("slice", 3)
+            {
+                uint8_t level = (uint8_t)getFieldInteger(&shellData, 1);    // Get arguments
+                uint16_t ticks = (uint16_t)getFieldInteger(&shellData, 2);  // Get arguments
+                setTimeSlice(level, ticks);                                 // Invoke function
+                putsUart0("\r\n\r\n");
+                yield();
+            }
+
             else IS_COMMAND("inheritance", 2)
             {
                 char *inheritanceState = getFieldString(&shellData, 1);     // Get arguments
@@ -162,16 +263,17 @@ void shell(void)
 
             else IS_COMMAND("ps", 1)
             {
-                psInfo_t psInfo[12];
+                psInfo_t *psInfo = reply.ps;
+                uint32_t switches = 0;
 
                 uint8_t i;
                 ps((void *)psInfo);                                         // Invoke function
 
-                putsUart0("Task\t PID\t CPU\t Name\r\n");
+                putsUart0("Task\t PID\t CPU\t Target\t Switches\t Stack\t\t Name\r\n");
 
-                for (i = 0; i < 12; i++)
+                for (i = 0; i < MAX_TASKS; i++)
                 {
-                    if (!psInfo[i].pid)     break;
+                    if (!psInfo[i].pid)     continue;                       // Unused TCB record
 
                     putsUart0(itoa(psInfo[i].task, dest));
                     putsUart0("\t ");
@@ -182,12 +284,184 @@ void shell(void)
                     putsUart0(insertDot(itoa(psInfo[i].cpuTime, dest)));
                     putsUart0("%\t ");
 
+                    if (psInfo[i].targetShare)      putsUart0(insertDot(itoa(psInfo[i].targetShare, dest)));
+                    else                            putsUart0("-");
+                    putsUart0("%\t ");
+
+                    putsUart0(itoa(psInfo[i].switches, dest));             // Times switched in during the last window
+                    putsUart0("\t\t ");
+                    switches += psInfo[i].switches;
+
+                    putsUart0(itoa(psInfo[i].stackUsed, dest));
+                    putsUart0("/");
+                    putsUart0(itoa(psInfo[i].stackSize, dest));
+                    putsUart0("\t ");
+
                     putsUart0(psInfo[i].name);
                     putsUart0("\r\n");
                 }
+                putsUart0("\r\nContext switches: ");
+                putsUart0(itoa(switches, dest));
+                putsUart0(" in the last 2 s\r\n\r\n");
+                yield();
+            }
+
+#if CONFIG_POOLS
+            else IS_COMMAND("pools", 1)
+            {
+                poolInfo_t *poolInfo = reply.pools;
+
+                uint8_t i;
+                pools((void *)poolInfo);                                    // Invoke function
+
+                putsUart0("Pool\t\t Size\t Blocks\t Used\t Peak\r\n");
+
+                for (i = 0; i < MAX_POOLS; i++)
+                {
+                    if (!poolInfo[i].blockCount)    break;
+
+                    putsUart0(poolInfo[i].name);
+                    putsUart0("\t\t ");
+
+                    putsUart0(itoa(poolInfo[i].blockSize, dest));
+                    putsUart0("\t ");
+
+                    putsUart0(itoa(poolInfo[i].blockCount, dest));
+                    putsUart0("\t ");
+
+                    putsUart0(itoa(poolInfo[i].used, dest));
+                    putsUart0("\t ");
+
+                    putsUart0(itoa(poolInfo[i].highWater, dest));
+                    putsUart0("\r\n");
+                }
+                putsUart0("\r\n\r\n");
+                yield();
+            }
+#endif
+
+            else IS_COMMAND("meminfo", 1)
+            {
+                heapInfo_t *heapInfo = &reply.meminfo;
+                uint32_t freeBytes = 0, largestFree = 0;
+
+                uint8_t i, j;
+                meminfo((void *)heapInfo);                                  // Invoke function
+
+                putsUart0("Region\t\t Block\t Map\t\t Free\t Largest\r\n");
+
+                for (i = 0; i < heapInfo->regionCount; i++)
+                {
+                    putsUart0(htoa(heapInfo->regions[i].baseAddr, dest));
+                    putsUart0("\t ");
+
+                    putsUart0(itoa(heapInfo->regions[i].blockSize, dest));
+                    putsUart0("\t ");
+
+                    for (j = 0; j < 8; j++)                                 // Lowest subregion first, # = allocated
+                    {
+                        putsUart0((heapInfo->regions[i].used & (1 << j)) ? "#" : ".");
+                    }
+                    putsUart0("\t ");
+
+                    putsUart0(itoa(heapInfo->regions[i].freeBytes, dest));
+                    putsUart0("\t ");
+
+                    putsUart0(itoa(heapInfo->regions[i].largestFree, dest));
+                    putsUart0("\r\n");
+
+                    freeBytes += heapInfo->regions[i].freeBytes;
+                    if (heapInfo->regions[i].largestFree > largestFree)      largestFree = heapInfo->regions[i].largestFree;
+                }
+
+                putsUart0("\r\nAddress\t\t Size\t Owner\r\n");
+
+                for (i = 0; i < heapInfo->allocationCount; i++)
+                {
+                    putsUart0(htoa(heapInfo->allocations[i].address, dest));
+                    putsUart0("\t ");
+
+                    putsUart0(itoa(heapInfo->allocations[i].size, dest));
+                    putsUart0("\t ");
+
+                    putsUart0(heapInfo->allocations[i].owner);
+                    putsUart0("\r\n");
+                }
+
+                putsUart0("\r\nFree: ");
+                putsUart0(itoa(freeBytes, dest));
+                putsUart0("\t Largest: ");
+                putsUart0(itoa(largestFree, dest));
+                putsUart0("\t Fragmentation: ");
+                putsUart0(itoa(freeBytes ? 100 - (100 * largestFree / freeBytes) : 0, dest));  // Share of free memory outside the largest run
+                putsUart0("%\r\n\r\n");
+                yield();
+            }
+
+#if CONFIG_PERIODIC_TASKS
+            else IS_COMMAND("rtstat", 1)
+            {
+                rtStatInfo_t *rtStatInfo = reply.rtstat;
+
+                uint8_t i;
+                rtstat((void *)rtStatInfo);                                 // Invoke function
+
+                putsUart0("PID\t Period\t WCET\t Exec\t Resp min/avg/max\t Jobs\t Misses\t Name\r\n");
+
+                for (i = 0; i < MAX_TASKS; i++)
+                {
+                    if (!rtStatInfo[i].pid)     continue;                   // Not a periodic thread
+
+                    putsUart0(itoa(rtStatInfo[i].pid, dest));
+                    putsUart0("\t ");
+
+                    putsUart0(itoa(rtStatInfo[i].periodUs, dest));
+                    putsUart0("\t ");
+
+                    putsUart0(itoa(rtStatInfo[i].wcetUs, dest));              // Declared
+                    putsUart0("\t ");
+
+                    putsUart0(itoa(rtStatInfo[i].execMaxUs, dest));           // Measured
+                    putsUart0("\t ");
+
+                    putsUart0(itoa(rtStatInfo[i].responseMinUs, dest));
+                    putsUart0("/");
+                    putsUart0(itoa(rtStatInfo[i].responseAvgUs, dest));
+                    putsUart0("/");
+                    putsUart0(itoa(rtStatInfo[i].responseMaxUs, dest));
+                    putsUart0("\t\t ");
+
+                    putsUart0(itoa(rtStatInfo[i].jobs, dest));
+                    putsUart0("\t ");
+
+                    putsUart0(itoa(rtStatInfo[i].misses, dest));
+                    putsUart0("\t ");
+
+                    putsUart0(rtStatInfo[i].name);
+                    putsUart0("\r\n");
+                }
+                putsUart0("\r\nTimes in us\r\n\r\n");
+                yield();
+            }
+#endif
+
+#if CONFIG_TRACE
+            else IS_COMMAND("trace", 1)
+            {
+                traceChunk_t *chunk = &reply.trace;
+
+                chunk->next = 0;                                            // From the oldest record held
+                chunk->end = 0;                                             // To the newest one now
+                putsUart0("\r\n");
+                do
+                {
+                    trace((void *)chunk);                                   // Invoke function
+                    putTraceFrame(chunk);                                   // Binary, decode with tools/traceDump.py
+                } while (chunk->count);
                 putsUart0("\r\n\r\n");
                 yield();
             }
+#endif
 
             else IS_COMMAND("help", 1)
             {
@@ -197,7 +471,17 @@ void shell(void)
                 putsUart0("\treboot     |\r\n");
                 putsUart0("\tipcs       |\r\n");
                 putsUart0("\tps         |\r\n");
-                putsUart0("\tsched      | [prio|rr]\r\n");
+#if CONFIG_POOLS
+                putsUart0("\tpools      |\r\n");
+#endif
+                putsUart0("\tmeminfo    |\r\n");
+#if CONFIG_PERIODIC_TASKS
+                putsUart0("\trtstat     |\r\n");
+#endif
+#if CONFIG_TRACE
+                putsUart0("\ttrace      |\r\n");
+#endif
+                putsUart0("\tsched      | <prio|rr|stride>\r\n");
                 putsUart0("\tpreempt    | [on|off]\r\n");
                 putsUart0("\tinheritance| [on|off]\r\n");
                 putsUart0("\tkill       | <pid>\r\n");
@@ -205,6 +489,20 @@ void shell(void)
                 putsUart0("\tpkill      | <function_name>\r\n");
                 putsUart0("\trun        | <function_name>\r\n");
                 putsUart0("\tsetpriority| <pid> <priority>\r\n");
+                putsUart0("\tthreshold  | <pid> <priority>\r\n");
+                putsUart0("\tslice      | <priority> <ticks>\r\n");
+#if CONFIG_WORKERS
+                putsUart0("\tjob        | <flashes>\r\n");
+#endif
+#if CONFIG_STRIDE_SCHEDULER
+                putsUart0("\ttickets    | <pid> <tickets>\r\n");
+#endif
+#if CONFIG_PRIORITY_AGING
+                putsUart0("\taging      | <pid> [on|off]\r\n");
+#endif
+#if CONFIG_CPU_BUDGETS
+                putsUart0("\tbudget     | <pid> <us per period> <suspend on|off>\r\n");
+#endif
                 putsUart0("\r\n\r\n");
             }
 
@@ -1,20 +1,42 @@
 #ifndef SHELL_H
 #define SHELL_H
 
+#include "kernelConfig.h"
+
 typedef struct
 {
     uint8_t task;
     uint32_t pid;
     uint32_t cpuTime;
+    uint32_t switches;
+    uint32_t targetShare;
+    uint32_t stackUsed;
+    uint32_t stackSize;
     char name[10];
 } psInfo_t;
 
+#if CONFIG_PERIODIC_TASKS
+typedef struct
+{
+    uint32_t pid;                   // 0 for records that are not periodic threads
+    uint32_t periodUs;
+    uint32_t wcetUs;                // declared when the thread was created
+    uint32_t execMaxUs;             // longest execution seen
+    uint32_t responseMinUs;
+    uint32_t responseAvgUs;
+    uint32_t responseMaxUs;
+    uint32_t jobs;
+    uint32_t misses;
+    char name[16];
+} rtStatInfo_t;
+#endif
+
 typedef struct
 {
     bool lock;
     uint16_t queueSize;
-    uint32_t processQueue[2];
-    char *processName[2][10];
+    uint32_t processQueue[MAX_MUTEX_QUEUE_SIZE];
+    char *processName[MAX_MUTEX_QUEUE_SIZE][10];
     uint32_t lockedBy;
     char *lockedByName[10];
 } mutexInfo_t;
@@ -23,8 +45,8 @@ typedef struct
 {
     uint16_t count;
     uint16_t queueSize;
-    uint32_t processQueue[2];
-    char *processName[2][10];
+    uint32_t processQueue[MAX_SEMAPHORE_QUEUE_SIZE];
+    char *processName[MAX_SEMAPHORE_QUEUE_SIZE][10];
 } semaphoreInfo_t;
 
 void shell(void);
@@ -0,0 +1,51 @@
+/**
+*      @file sramConfig.h
+*      @author Prithvi Bhat
+*      @brief SRAM layout shared by the linker command file and the memory manager
+*               The linker includes this file too, so it may only hold preprocessor definitions and C comments
+**/
+
+#ifndef SRAM_CONFIG_H
+#define SRAM_CONFIG_H
+
+#define SRAM_BASE_ADDR          0x20000000      /* Start of on-chip SRAM                                */
+#define SRAM_SIZE               0x00008000      /* 32K on the TM4C123GH6PM                              */
+#define KERNEL_SRAM_SIZE        0x00001000      /* OS stack and globals, privileged only, power of two  */
+#define SYSTEM_STACK_SIZE       0x00000200      /* OS stack in the kernel SRAM, keep equal to the project stack size */
+
+/**
+*      Heap regions in address order, starting right after the kernel SRAM
+*      Each region is covered by one MPU region split into 8 subregions, so every size must be
+*      a power of two of at least 256 bytes and the region must start on a multiple of its size
+*      At most 5 regions are available (MPU regions 3 to 7)
+**/
+#define HEAP_REGION_COUNT       5
+#define HEAP_REGION_SIZES       {0x1000, 0x2000, 0x1000, 0x1000, 0x2000}
+
+/**
+*      Stack protection mode
+*      1: every stack is a naturally aligned power of two block covered by one MPU region,
+*         a context switch moves that one region (MPU regions 4 to 7 stay free)
+*      0: stacks are subregion runs protected by SRD masks on every heap region (one write per region per switch)
+**/
+#define SINGLE_REGION_STACKS    1
+
+/**
+*      Stack overflow guard
+*      1: the lowest subregion of every heap stack allocation is left without access, so an overflow
+*         faults and is reported against the task; the guard is added below the requested stack,
+*         so a single region stack may double in size when the guard does not fit in its slack
+*      0: the whole allocation is usable
+**/
+#define STACK_GUARD             1
+
+/**
+*      Static stack area for STATIC_STACK, taken from the top of SRAM above the heap
+*      Outside both the kernel SRAM and the heap regions, so only the owning thread's stack region grants access
+*      Shrink HEAP_REGION_SIZES by the same amount, initMpu fails when the regions run past the heap end
+*      Every stack is aligned to its size, so leave room for the padding between stacks of different sizes
+*      0: no area, STATIC_STACK cannot be used
+**/
+#define STATIC_STACK_SRAM_SIZE  0
+
+#endif
@@ -0,0 +1,24 @@
+/**
+*      @file stackSizes.h
+*      @author Prithvi Bhat
+*      @brief Stack sizes for createThread, picked by hand until tools/stackUsage.py is run
+*               The script replaces them with the worst-case call depth plus 140 bytes of context switch frame,
+*               and keeps the sizes below for threads whose depth it cannot bound
+**/
+
+#ifndef STACK_SIZES_H
+#define STACK_SIZES_H
+
+#define STACK_SIZE_IDLE          448     // idle: not analysed yet
+#define STACK_SIZE_LENGTHYFN     896     // lengthyFn: not analysed yet
+#define STACK_SIZE_FLASH4HZ      896     // flash4Hz: not analysed yet
+#define STACK_SIZE_ONESHOT       896     // oneshot: not analysed yet
+#define STACK_SIZE_READKEYS      896     // readKeys: not analysed yet
+#define STACK_SIZE_DEBOUNCE      896     // debounce: not analysed yet
+#define STACK_SIZE_IMPORTANT     896     // important: not analysed yet
+#define STACK_SIZE_UNCOOPERATIVE 896     // uncooperative: not analysed yet
+#define STACK_SIZE_ERRANT        896     // errant: not analysed yet
+#define STACK_SIZE_SHELL         1792    // shell: unbounded, set by hand against shellStackCheck in shell.c
+#define STACK_SIZE_WORKER        896     // workerThread: unbounded, set by hand for the deepest job
+
+#endif
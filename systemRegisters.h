@@ -13,5 +13,13 @@ extern void stageMethod(uint32_t stackAddr);        // Function to load a value
 extern uint32_t getValue(uint32_t);                 // Get a value
 extern uint32_t getSvcPriority(void);               // Return the SVC priority
 extern uint32_t getArgs(void);                      // Return the argument value
+extern uint32_t countTrailingZeros(uint32_t value); // Return the index of the lowest set bit (32 if none)
+extern uint32_t countLeadingZeros(uint32_t value);  // Return the number of zeros above the highest set bit (32 if none)
+extern uint32_t getIPSR(void);                      // Return the active exception number (0 in thread mode)
+extern uint32_t getCONTROL(void);                   // Return the value of the CONTROL register
+extern uint32_t disableInterrupts(void);            // Set PRIMASK and return its previous value
+extern void restoreInterrupts(uint32_t primask);    // Restore a PRIMASK value returned by disableInterrupts
+
+#define IN_PRIVILEGED_CONTEXT()     (getIPSR() || !(getCONTROL() & 0x01))       // Handler mode or privileged thread mode
 
 #endif
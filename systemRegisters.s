@@ -10,6 +10,12 @@
     .def loadPSP
     .def getSvcPriority
     .def getArgs
+    .def countTrailingZeros
+    .def countLeadingZeros
+    .def getIPSR
+    .def getCONTROL
+    .def disableInterrupts
+    .def restoreInterrupts
 
 getPSP:
     MRS R0, PSP         ; Read the PSP register
@@ -66,3 +72,29 @@ getArgs:
     MRS R0, PSP         ; Load PSP into R0 to determine which function made the SV Call
     LDR R0, [R0]        ; Derefernce the value from PSP pointer
     BX  LR
+
+countTrailingZeros:
+    RBIT R0, R0         ; Reverse the bit order so the lowest set bit becomes the highest
+    CLZ R0, R0          ; Count the leading zeros of the reversed value
+    BX  LR              ; Return
+
+countLeadingZeros:
+    CLZ R0, R0          ; Count the zeros above the highest set bit
+    BX  LR              ; Return
+
+getIPSR:
+    MRS R0, IPSR        ; Read the number of the active exception
+    BX  LR              ; Return
+
+getCONTROL:
+    MRS R0, CONTROL     ; Read the current CONTROL register value
+    BX  LR              ; Return
+
+disableInterrupts:
+    MRS R0, PRIMASK     ; Return the current interrupt mask
+    CPSID I             ; Mask all configurable interrupts
+    BX  LR              ; Return
+
+restoreInterrupts:
+    MSR PRIMASK, R0     ; Load the saved interrupt mask
+    BX  LR              ; Return
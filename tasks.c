@@ -271,6 +271,23 @@ void errant(void)
     }
 }
 
+/**
+*      @brief Job for the worker pool, flashes the yellow LED at 4Hz
+*      @param arg number of flashes
+**/
+void flashJob(void *arg)
+{
+    uint32_t count = (uint32_t)arg;
+
+    while (count--)
+    {
+        setPinValue(YELLOW_LED, 1);
+        sleep(125);
+        setPinValue(YELLOW_LED, 0);
+        sleep(125);
+    }
+}
+
 /**
 *      @brief A function with the highest priority that toggles the blue LED
 **/
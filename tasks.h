@@ -28,5 +28,6 @@ void debounce(void);
 void uncooperative(void);
 void errant(void);
 void important(void);
+void flashJob(void *arg);
 
 #endif
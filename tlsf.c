@@ -0,0 +1,229 @@
+/**
+*      @file tlsf.c
+*      @author Prithvi Bhat
+*      @brief Two-Level Segregated Fit allocator
+*               Free blocks are kept in lists segregated by a power of two (first level) and a linear split of it (second level)
+*               Two bitmaps locate the smallest non-empty list with a bit scan, so allocation and release take constant time
+*               No state is kept outside the managed memory, which lets a task run it without privileges
+**/
+
+#include <stdint.h>
+#include "tlsf.h"
+#include "systemRegisters.h"
+#include "kernelConfig.h"
+
+#if CONFIG_THREAD_HEAPS
+
+#define NULL                0x00000000
+
+#define HEADER_SIZE         ((uintptr_t)&((tlsfBlock_t *)0)->nextFree)          // prevPhys and size, 8 bytes on the target
+#define MIN_BLOCK_SIZE      (2 * sizeof(tlsfBlock_t *))                         // Room for the free list links
+#define MAX_BLOCK_SIZE      ((uint32_t)1 << (TLSF_FL_INDEX_MAX + 1))
+#define SMALL_BLOCK_SIZE    ((uint32_t)1 << TLSF_FL_SHIFT)
+
+#define BLOCK_FREE          0x01
+#define PREV_FREE           0x02
+#define SIZE_MASK           (~(uint32_t)(BLOCK_FREE | PREV_FREE))
+
+#define ALIGN_UP(value)     (((uintptr_t)(value) + (1 << TLSF_ALIGN_LOG2) - 1) & ~(uintptr_t)((1 << TLSF_ALIGN_LOG2) - 1))
+#define BLOCK_SIZE(block)   ((block)->size & SIZE_MASK)
+#define NEXT_PHYS(block)    ((tlsfBlock_t *)((uint8_t *)(block) + HEADER_SIZE + BLOCK_SIZE(block)))
+#define PAYLOAD(block)      ((void *)((uint8_t *)(block) + HEADER_SIZE))
+#define BLOCK_OF(ptr)       ((tlsfBlock_t *)((uint8_t *)(ptr) - HEADER_SIZE))
+#define FLS(value)          (31 - countLeadingZeros(value))                     // Index of the highest set bit
+
+/**
+*      @brief Function to map a block size to the free list holding blocks of that size
+*      @param size of the block
+*      @param fl location to store the first level index
+*      @param sl location to store the second level index
+**/
+void mapSize(uint32_t size, uint8_t *fl, uint8_t *sl)
+{
+    if (size < SMALL_BLOCK_SIZE)                                                // Small sizes are split linearly
+    {
+        *fl = 0;
+        *sl = size / (SMALL_BLOCK_SIZE / TLSF_SL_COUNT);
+    }
+    else
+    {
+        uint8_t msb = FLS(size);
+        *sl = (size >> (msb - TLSF_SL_LOG2)) ^ TLSF_SL_COUNT;                   // Bits just below the leading one
+        *fl = msb - (TLSF_FL_SHIFT - 1);
+    }
+}
+
+/**
+*      @brief Function to insert a free block at the head of its list
+*      @param tlsf heap control structure
+*      @param block to be inserted
+**/
+void insertBlock(tlsf_t *tlsf, tlsfBlock_t *block)
+{
+    uint8_t fl, sl;
+    mapSize(BLOCK_SIZE(block), &fl, &sl);
+
+    block->prevFree = NULL;
+    block->nextFree = tlsf->blocks[fl][sl];
+    if (block->nextFree)    block->nextFree->prevFree = block;
+    tlsf->blocks[fl][sl] = block;
+
+    tlsf->flBitmap |= (1 << fl);                                                // Mark the lists as non-empty
+    tlsf->slBitmap[fl] |= (1 << sl);
+}
+
+/**
+*      @brief Function to unlink a free block from its list
+*      @param tlsf heap control structure
+*      @param block to be removed
+**/
+void removeBlock(tlsf_t *tlsf, tlsfBlock_t *block)
+{
+    uint8_t fl, sl;
+    mapSize(BLOCK_SIZE(block), &fl, &sl);
+
+    if (block->nextFree)    block->nextFree->prevFree = block->prevFree;
+    if (block->prevFree)    block->prevFree->nextFree = block->nextFree;
+    else
+    {
+        tlsf->blocks[fl][sl] = block->nextFree;                                 // Block was the head of the list
+        if (!tlsf->blocks[fl][sl])
+        {
+            tlsf->slBitmap[fl] &= ~(1 << sl);                                   // List is now empty
+            if (!tlsf->slBitmap[fl])    tlsf->flBitmap &= ~(1 << fl);           // Class is now empty
+        }
+    }
+}
+
+/**
+*      @brief Function to initialise a heap in the given memory
+*      @param memory to be managed, the control structure is placed at its start
+*      @param bytes size of the memory
+*      @return tlsf_t* heap control structure, NULL if the memory is too small
+**/
+tlsf_t *tlsfInit(void *memory, uint32_t bytes)
+{
+    uintptr_t start = ALIGN_UP(memory);                                         // Pointer sized so the host benchmark can run it
+    uintptr_t end = ((uintptr_t)memory + bytes) & ~(uintptr_t)((1 << TLSF_ALIGN_LOG2) - 1);
+    uintptr_t pool = start + ALIGN_UP(sizeof(tlsf_t));
+    tlsf_t *tlsf = (tlsf_t *)start;
+    tlsfBlock_t *block, *sentinel;
+    uint8_t i, j;
+
+    if (end < pool + (2 * HEADER_SIZE) + MIN_BLOCK_SIZE)    return NULL;        // Not even one block fits
+
+    tlsf->flBitmap = 0;
+    for (i = 0; i < TLSF_FL_COUNT; i++)
+    {
+        tlsf->slBitmap[i] = 0;
+        for (j = 0; j < TLSF_SL_COUNT; j++)     tlsf->blocks[i][j] = NULL;
+    }
+
+    block = (tlsfBlock_t *)pool;                                                // One free block spanning the memory
+    block->prevPhys = NULL;
+    block->size = end - pool - (2 * HEADER_SIZE);
+    if (block->size >= MAX_BLOCK_SIZE)      block->size = MAX_BLOCK_SIZE - (1 << TLSF_ALIGN_LOG2);
+    block->size |= BLOCK_FREE;
+
+    sentinel = NEXT_PHYS(block);                                                // Zero sized used block stops merging at the end
+    sentinel->prevPhys = block;
+    sentinel->size = PREV_FREE;
+
+    insertBlock(tlsf, block);
+    return tlsf;
+}
+
+/**
+*      @brief Function to allocate memory from a heap
+*      @param tlsf heap control structure
+*      @param size requested in bytes
+*      @return void* address of the allocated memory, NULL if no block is large enough
+**/
+void *tlsfMalloc(tlsf_t *tlsf, uint32_t size)
+{
+    uint8_t fl, sl;
+    uint32_t slMap, flMap, remaining;
+    tlsfBlock_t *block, *next;
+
+    if (!tlsf || size >= MAX_BLOCK_SIZE)    return NULL;                        // Before rounding, which wraps near 4G
+    size = (size < MIN_BLOCK_SIZE) ? MIN_BLOCK_SIZE : ALIGN_UP(size);
+    if (size >= MAX_BLOCK_SIZE)             return NULL;
+
+    // Round up to the next list boundary so any block in the list found will fit
+    if (size >= SMALL_BLOCK_SIZE)   mapSize(size + (1 << (FLS(size) - TLSF_SL_LOG2)) - 1, &fl, &sl);
+    else                            mapSize(size, &fl, &sl);
+    if (fl >= TLSF_FL_COUNT)    return NULL;
+
+    slMap = tlsf->slBitmap[fl] & (~(uint32_t)0 << sl);                          // Lists in this class at least as large
+    if (!slMap)
+    {
+        flMap = tlsf->flBitmap & (~(uint32_t)0 << (fl + 1));                    // Any larger class
+        if (!flMap)     return NULL;
+
+        fl = countTrailingZeros(flMap);
+        slMap = tlsf->slBitmap[fl];
+    }
+    sl = countTrailingZeros(slMap);
+
+    block = tlsf->blocks[fl][sl];
+    removeBlock(tlsf, block);
+
+    remaining = BLOCK_SIZE(block) - size;
+    if (remaining >= HEADER_SIZE + MIN_BLOCK_SIZE)                              // Split off the tail as a new free block
+    {
+        next = (tlsfBlock_t *)((uint8_t *)PAYLOAD(block) + size);
+        next->prevPhys = block;
+        next->size = (remaining - HEADER_SIZE) | BLOCK_FREE;
+        NEXT_PHYS(next)->prevPhys = next;
+        NEXT_PHYS(next)->size |= PREV_FREE;
+
+        block->size = size | (block->size & PREV_FREE);
+        insertBlock(tlsf, next);
+    }
+    else
+    {
+        block->size &= ~BLOCK_FREE;
+        NEXT_PHYS(block)->size &= ~PREV_FREE;
+    }
+
+    return PAYLOAD(block);
+}
+
+/**
+*      @brief Function to release memory back to a heap, merging it with free neighbours
+*      @param tlsf heap control structure
+*      @param ptr address returned by tlsfMalloc
+**/
+void tlsfFree(tlsf_t *tlsf, void *ptr)
+{
+    tlsfBlock_t *block, *next, *prev;
+
+    if (!tlsf || !ptr)  return;
+
+    block = BLOCK_OF(ptr);
+    if (block->size & BLOCK_FREE)   return;                                     // Already free
+
+    if (block->size & PREV_FREE)                                                // Merge with the previous block
+    {
+        prev = block->prevPhys;
+        removeBlock(tlsf, prev);
+        prev->size += HEADER_SIZE + BLOCK_SIZE(block);
+        block = prev;
+    }
+
+    next = NEXT_PHYS(block);
+    if (next->size & BLOCK_FREE)                                                // Merge with the next block
+    {
+        removeBlock(tlsf, next);
+        block->size += HEADER_SIZE + BLOCK_SIZE(next);
+        next = NEXT_PHYS(block);
+    }
+
+    block->size |= BLOCK_FREE;
+    next->prevPhys = block;
+    next->size |= PREV_FREE;
+
+    insertBlock(tlsf, block);
+}
+
+#endif
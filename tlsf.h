@@ -0,0 +1,45 @@
+/**
+*      @file tlsf.h
+*      @author Prithvi Bhat
+*      @brief Header file for the Two-Level Segregated Fit allocator backing the per-task heaps
+**/
+
+#ifndef TLSF_H
+#define TLSF_H
+
+#include <inttypes.h>
+
+#define TLSF_ALIGN_LOG2         3                                       // Blocks are 8 byte aligned
+#define TLSF_SL_LOG2            2                                       // 4 second level lists per first level class
+#define TLSF_FL_INDEX_MAX       13                                      // Largest block is just under 16K
+#define TLSF_FL_SHIFT           (TLSF_SL_LOG2 + TLSF_ALIGN_LOG2)
+#define TLSF_FL_COUNT           (TLSF_FL_INDEX_MAX - TLSF_FL_SHIFT + 2)
+#define TLSF_SL_COUNT           (1 << TLSF_SL_LOG2)
+
+/**
+*      @brief Header of a block in the heap
+*               Links are only valid while the block is free and overlay the first 8 bytes of the payload
+**/
+typedef struct _tlsfBlock
+{
+    struct _tlsfBlock *prevPhys;                                        // Physically previous block
+    uint32_t size;                                                      // Payload size, bit 0 = free, bit 1 = previous block free
+    struct _tlsfBlock *nextFree;                                         // Next block in the same free list
+    struct _tlsfBlock *prevFree;                                         // Previous block in the same free list
+} tlsfBlock_t;
+
+/**
+*      @brief Control structure of a heap, placed at the start of the memory it manages
+**/
+typedef struct
+{
+    uint32_t flBitmap;                                                  // Bit set for every first level class with a free block
+    uint8_t slBitmap[TLSF_FL_COUNT];                                    // Bit set for every second level list with a free block
+    tlsfBlock_t *blocks[TLSF_FL_COUNT][TLSF_SL_COUNT];                  // Heads of the free lists
+} tlsf_t;
+
+tlsf_t *tlsfInit(void *memory, uint32_t bytes);
+void *tlsfMalloc(tlsf_t *tlsf, uint32_t size);
+void tlsfFree(tlsf_t *tlsf, void *ptr);
+
+#endif
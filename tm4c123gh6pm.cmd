@@ -4,16 +4,23 @@
  *
  * This is derived from revision 15071 of the TivaWare Library.
  *
- * SRAM (RWX) : origin = 0x20001000, length = 0x00007000
+ * SRAM (RWX) : origin = SRAM_BASE_ADDR, length = KERNEL_SRAM_SIZE
+ *
+ * The rest of SRAM is left to the memory manager, laid out by sramConfig.h
  * 
  *****************************************************************************/
 
+#include "sramConfig.h"
+
 --retain=g_pfnVectors
 
 MEMORY
 {
     FLASH (RX) : origin = 0x00000000, length = 0x00040000
-    SRAM (RWX) : origin = 0x20000000, length = 0x00001000
+    SRAM (RWX) : origin = SRAM_BASE_ADDR, length = KERNEL_SRAM_SIZE
+#if STATIC_STACK_SRAM_SIZE
+    STATIC (RW) : origin = SRAM_BASE_ADDR + SRAM_SIZE - STATIC_STACK_SRAM_SIZE, length = STATIC_STACK_SRAM_SIZE
+#endif
 }
 
 /* The following command line options are set as part of the CCS project.    */
@@ -42,6 +49,13 @@ SECTIONS
     .bss    :   > SRAM
     .sysmem :   > SRAM
     .stack  :   > SRAM
+#if STATIC_STACK_SRAM_SIZE
+    .staticStack : > STATIC, type = NOINIT
+#endif
 }
 
-__STACK_TOP = __stack + 512;
+__STACK_TOP = __stack + SYSTEM_STACK_SIZE;
+
+/* Heap bounds used by the memory manager to build its region map */
+__heap_base = SRAM_BASE_ADDR + KERNEL_SRAM_SIZE;
+__heap_end  = SRAM_BASE_ADDR + SRAM_SIZE - STATIC_STACK_SRAM_SIZE;
@@ -0,0 +1,220 @@
+/**
+*      @file heapCheck.c
+*      @author Prithvi Bhat
+*      @brief Host check and benchmark of the subregion bitmap allocator in mm.c
+*               findFreeRun is compared with a brute force search over random ledgers, then fragmentation
+*               scenarios are played on the default sramConfig.h layout, then allocation is timed against
+*               a linear scan of one byte per subregion (the ledger layout the bitmap replaced)
+*               The allocator only does arithmetic on addresses, so the heap bounds are plain linker symbols
+*
+*      Build and run (from the repository root):
+*          gcc -std=gnu99 -O2 -Wall -Wextra -fno-builtin -I. -no-pie -Wl,--defsym,__heap_base=0x20001000 -Wl,--defsym,__heap_end=0x20008000 \
+*              tools/heapCheck.c mm.c -o heapCheck && ./heapCheck
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "mm.h"
+
+#define SUBREGIONS          (HEAP_REGION_COUNT * 8)
+#define BENCH_ROUNDS        1000000
+#define CHECK(condition)    check(condition, #condition, __LINE__)
+
+// Allocator state, see mm.c
+extern uint64_t heapLedger_g;
+extern uint8_t heapTop_g;
+bool initHeapRegions(void);
+int8_t findFreeRun(uint64_t window, uint8_t subRegions);
+
+uint32_t failures = 0;
+
+// Stand-ins for the assembly helpers in systemRegisters.s
+uint32_t countLeadingZeros(uint32_t value)  { return value ? __builtin_clz(value) : 32; }
+uint32_t countTrailingZeros(uint32_t value) { return value ? __builtin_ctz(value) : 32; }
+
+void check(bool condition, const char *text, int line)
+{
+    if (condition)  return;
+    printf("FAIL line %d: %s\n", line, text);
+    failures++;
+}
+
+void resetHeap(void)
+{
+    heapLedger_g = 0;
+    heapTop_g = 0;
+}
+
+/**
+*      @brief Reference search, one subregion at a time
+*      @return int8_t first subregion of the lowest free run inside the window, -1 if none
+**/
+int8_t bruteFreeRun(uint64_t ledger, uint64_t window, uint8_t subRegions)
+{
+    uint8_t start, i;
+
+    for (start = 0; start + subRegions <= 64; start++)
+    {
+        for (i = 0; i < subRegions; i++)
+        {
+            if (!(window >> (start + i) & 1) || (ledger >> (start + i) & 1))    break;
+        }
+        if (i == subRegions)    return start;
+    }
+    return -1;
+}
+
+void checkFreeRuns(void)
+{
+    uint64_t window, ledger;
+    uint32_t round;
+    uint8_t length;
+
+    srand(1);
+    for (round = 0; round < 100000; round++)
+    {
+        ledger = ((uint64_t)rand() << 33) ^ ((uint64_t)rand() << 11) ^ rand();
+        ledger &= ((uint64_t)rand() << 33) ^ ((uint64_t)rand() << 11) ^ rand();  // Sparse enough to leave long runs
+        window = (round & 1) ? ~(uint64_t)0 : ((uint64_t)0xFF << (8 * (rand() % 8)));
+        length = 1 + rand() % 8;
+
+        heapLedger_g = ledger;
+        if (findFreeRun(window, length) != bruteFreeRun(ledger, window, length))
+        {
+            printf("FAIL ledger %016llx window %016llx length %d\n", (unsigned long long)ledger, (unsigned long long)window, length);
+            failures++;
+            break;
+        }
+    }
+    resetHeap();
+}
+
+void checkFragmentation(void)
+{
+    void *blocks[SUBREGIONS];
+    heapInfo_t info;
+    uint32_t freeBytes = 0, largest = 0;
+    uint8_t count, i;
+
+    // Every subregion outside the boundary pairs takes one 512 byte request (7 + 6 + 7 + 7 + 7)
+    for (count = 0; count < SUBREGIONS && (blocks[count] = mallocFromHeap(512)) != NULL; count++);
+    CHECK(count == 34);
+
+    for (i = 1; i < count; i += 2)  freeToHeap(blocks[i]);                      // Every other one, no two free neighbours
+
+    getHeapInfo(&info);
+    for (i = 0; i < info.regionCount; i++)
+    {
+        freeBytes += info.regions[i].freeBytes;
+        if (info.regions[i].largestFree > largest)  largest = info.regions[i].largestFree;
+    }
+    CHECK(freeBytes == 16896);                                                  // 17 freed subregions and the 4 boundary pairs
+    CHECK(largest == 2048);                                                     // Only a boundary pair is longer than one subregion
+
+    CHECK(mallocFromHeap(2048) == NULL);                                        // Enough free memory but no run for it
+    CHECK(mallocFromHeap(1024) == (void *)0x20002400);                          // A single 1K subregion still fits
+
+    // A request too large for either side of a boundary takes the subregion pair straddling it
+    CHECK(mallocFromHeap(1536) == (void *)0x20001E00);
+    CHECK(mallocFromHeap(1536) == (void *)0x20003C00);
+    CHECK(mallocFromHeap(1536) == (void *)0x20005E00);
+    CHECK(mallocFromHeap(1536) == NULL);                                        // Boundaries used up, no three free 512s in a row
+
+    freeToHeap(blocks[2]);                                                      // Subregions 1 to 3 of the first region join up
+    CHECK(mallocFromHeap(1536) == (void *)0x20001200);
+    resetHeap();
+
+    // Aligned blocks only start on a multiple of their size
+    CHECK(mallocFromHeap(1536) == (void *)0x20001E00);                          // Takes the top of the first region
+    CHECK(mallocAlignedFromHeap(2048) == (void *)0x20001000);
+    CHECK(mallocAlignedFromHeap(2048) == (void *)0x20002800);                   // Not 0x20001800, which overlaps the pair
+    CHECK(mallocAlignedFromHeap(4096) == (void *)0x20003000);
+
+    // Released space is handed out again at once
+    CHECK(freeToHeap((void *)0x20003000));
+    CHECK(!freeToHeap((void *)0x20003000));
+    CHECK(mallocAlignedFromHeap(4096) == (void *)0x20003000);
+    resetHeap();
+}
+
+/**
+*      @brief Allocation with one byte per subregion, searched linearly as before the bitmap
+**/
+int8_t scanFreeRun(const uint8_t *allotment, uint8_t first, uint8_t last, uint8_t subRegions)
+{
+    uint8_t i, run = 0;
+
+    for (i = first; i <= last; i++)
+    {
+        run = allotment[i] ? 0 : run + 1;
+        if (run == subRegions)  return i - subRegions + 1;
+    }
+    return -1;
+}
+
+void benchmark(void)
+{
+    static uint64_t ledgers[4096];
+    static uint8_t allotments[4096][SUBREGIONS];
+    uint64_t window = ((uint64_t)1 << SUBREGIONS) - 1;
+    volatile int32_t sink = 0;
+    uint32_t round, i, slot;
+    uint8_t bit;
+    void *held[16] = {0};
+    clock_t start;
+    double bitmapNs, scanNs, mallocNs;
+
+    for (i = 0; i < 4096; i++)                                                  // The same random ledgers in both layouts
+    {
+        ledgers[i] = ((uint64_t)rand() << 33) ^ ((uint64_t)rand() << 11) ^ rand();
+        ledgers[i] &= ((uint64_t)rand() << 33) ^ ((uint64_t)rand() << 11) ^ rand();
+        for (bit = 0; bit < SUBREGIONS; bit++)      allotments[i][bit] = ledgers[i] >> bit & 1;
+    }
+
+    start = clock();
+    for (round = 0; round < BENCH_ROUNDS; round++)
+    {
+        heapLedger_g = ledgers[round & 4095];
+        sink += findFreeRun(window, 1 + (round & 3));
+    }
+    bitmapNs = (double)(clock() - start) * 1e9 / CLOCKS_PER_SEC / BENCH_ROUNDS;
+
+    start = clock();
+    for (round = 0; round < BENCH_ROUNDS; round++)
+    {
+        sink += scanFreeRun(allotments[round & 4095], 0, SUBREGIONS - 1, 1 + (round & 3));
+    }
+    scanNs = (double)(clock() - start) * 1e9 / CLOCKS_PER_SEC / BENCH_ROUNDS;
+    resetHeap();
+
+    start = clock();                                                            // Whole requests on a busy heap, one freed per one made
+    for (round = 0; round < BENCH_ROUNDS; round++)
+    {
+        slot = round & 15;
+        if (held[slot])     freeToHeap(held[slot]);
+        held[slot] = mallocFromHeap((1 + round % 3) * 512);
+    }
+    mallocNs = (double)(clock() - start) * 1e9 / CLOCKS_PER_SEC / BENCH_ROUNDS;
+    resetHeap();
+
+    printf("free run search, bitmap     %6.1f ns\n", bitmapNs);
+    printf("free run search, byte scan  %6.1f ns\n", scanNs);
+    printf("mallocFromHeap + freeToHeap %6.1f ns\n", mallocNs);
+}
+
+int main(void)
+{
+    if (!initHeapRegions())
+    {
+        printf("FAIL sramConfig.h layout rejected\n");
+        return 1;
+    }
+
+    checkFreeRuns();
+    checkFragmentation();
+    benchmark();
+
+    printf("%s\n", failures ? "FAILED" : "PASSED");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,145 @@
+#!/usr/bin/env python3
+"""
+    @file stackUsage.py
+    @author Prithvi Bhat
+    @brief Static stack-usage analysis that sizes the createThread stacks in rtos.c
+
+    The TI compiler used by the CCS project does not emit per-function stack usage, so the sources
+    are compiled a second time with arm-none-eabi-gcc using -fstack-usage and -fcallgraph-info.
+    The call graph is walked from every thread entry point passed to createThread in rtos.c, and the
+    worst-case depth plus the context switch frame is written to stackSizes.h.
+
+    Usage (from the repository root):
+        python3 tools/stackUsage.py [--cc arm-none-eabi-gcc] [--out stackSizes.h] [--require]
+
+    The CCS project runs it as a pre-build step. Without the compiler on the path it keeps the sizes
+    already in stackSizes.h and says so in the build output, unless --require is given.
+    The header is only rewritten when a size changes, so an unchanged analysis does not rebuild rtos.c.
+
+    Paths through function pointers or recursion cannot be bounded. They are reported, and the thread
+    keeps the size already in stackSizes.h, which is where such sizes are set by hand.
+"""
+
+import argparse
+import glob
+import os
+import re
+import shutil
+import subprocess
+import sys
+import tempfile
+
+CFLAGS = ["-mcpu=cortex-m4", "-mthumb", "-mfloat-abi=hard", "-mfpu=fpv4-sp-d16", "-O2", "-ffreestanding",
+          "-fstack-usage", "-fcallgraph-info=su", "-w", "-S"]
+
+# Pushed onto the task stack on every preemption: the hardware frame with lazy FPU state (26 words)
+# and the registers saved by pendSvIsr (R4-R11 and EXC_RETURN)
+FRAME_BYTES = 26 * 4 + 9 * 4
+
+NODE = re.compile(r'node:\s*{\s*title:\s*"([^"]+)"\s*label:\s*"([^"]*)"')
+EDGE = re.compile(r'edge:\s*{\s*sourcename:\s*"([^"]+)"\s*targetname:\s*"([^"]+)"')
+BYTES = re.compile(r'\\n(\d+) bytes \((\w+)')
+THREAD = re.compile(r'^[^/\n]*createThread\w*\(\s*(\w+)\s*,\s*"[^"]*"\s*,[^,]+,\s*(STACK_SIZE_\w+)', re.M)
+WORKERS = re.compile(r'^[^/\n]*initWorkers\([^,]+,[^,]+,\s*(STACK_SIZE_\w+)', re.M)
+DEFINE = re.compile(r'#define\s+(\w+)\s+\(?\s*(0x[0-9A-Fa-f]+|\d+)')
+
+
+def compile_sources(cc, root, work):
+    """Compile every C source to assembly, leaving the .su and .ci files in work"""
+    for source in sorted(glob.glob(os.path.join(root, "*.c"))):
+        if source.endswith("_startup_ccs.c"):
+            continue                                            # Vector table, no thread runs through it
+        output = os.path.join(work, os.path.basename(source)[:-2] + ".s")
+        result = subprocess.run([cc] + CFLAGS + ["-I", root, source, "-o", output], cwd=work)
+        if result.returncode:
+            sys.exit("stackUsage: failed to compile " + source)
+
+
+def read_call_graph(work):
+    """Return the frame size and callees of every function"""
+    frames, calls = {}, {}
+    for path in glob.glob(os.path.join(work, "*.ci")):
+        text = open(path).read()
+        for title, label in NODE.findall(text):
+            match = BYTES.search(label)
+            frames[title] = int(match.group(1)) if match else 0
+            if match and match.group(2) != "static":
+                calls.setdefault(title, set()).add("__dynamic_frame")
+        for source, target in EDGE.findall(text):
+            calls.setdefault(source, set()).add(target)
+    return frames, calls
+
+
+def worst_case(fn, frames, calls, path, problems):
+    """Deepest stack from fn, recording anything that cannot be bounded"""
+    if fn in path:
+        problems.add("recursion through " + fn)
+        return 0
+    if fn.startswith("__indirect_call") or fn == "__dynamic_frame":
+        problems.add("indirect call or dynamic frame below " + path[-1])
+        return 0
+    if fn not in frames:
+        return 0                                                # Assembly helpers in systemRegisters.s do not use the stack
+
+    deepest = 0
+    for callee in calls.get(fn, ()):
+        deepest = max(deepest, worst_case(callee, frames, calls, path + [fn], problems))
+    return frames[fn] + deepest
+
+
+def request_size(usage):
+    """createThread request holding usage bytes, the allocator adds the guard below it"""
+    return (usage + 7) & ~7
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("@brief")[1].splitlines()[0].strip())
+    parser.add_argument("--cc", default="arm-none-eabi-gcc")
+    parser.add_argument("--out", default="stackSizes.h")
+    parser.add_argument("--require", action="store_true", help="fail instead of keeping the sizes without a compiler")
+    args = parser.parse_args()
+
+    if not shutil.which(args.cc):
+        message = "stackUsage: %s not found, stack sizes in %s not checked" % (args.cc, args.out)
+        if args.require:
+            sys.exit(message)
+        print("warning: " + message)
+        return
+
+    root = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+    out = os.path.join(root, args.out)
+    previous = dict(DEFINE.findall(open(out).read())) if os.path.exists(out) else {}
+    source = open(os.path.join(root, "rtos.c")).read()
+    threads = THREAD.findall(source) + [("workerThread", macro) for macro in WORKERS.findall(source)]
+
+    with tempfile.TemporaryDirectory() as work:
+        compile_sources(args.cc, root, work)
+        frames, calls = read_call_graph(work)
+
+    lines = []
+    for fn, macro in threads:
+        problems = set()
+        usage = worst_case(fn, frames, calls, [], problems) + FRAME_BYTES
+        if problems:
+            if macro not in previous:
+                sys.exit("stackUsage: %s is unbounded, set %s by hand in %s" % (fn, macro, args.out))
+            size = int(previous[macro], 0)
+            print("%-16s unbounded (%s), keeping %d" % (fn, "; ".join(sorted(problems)), size))
+            lines.append("#define %-24s %-8d// %s: unbounded, kept from the last run" % (macro, size, fn))
+        else:
+            size = request_size(usage)
+            print("%-16s %5d bytes worst case, request %d" % (fn, usage, size))
+            lines.append("#define %-24s %-8d// %s: %d bytes worst case" % (macro, size, fn, usage))
+
+    text = ("/**\n*      @file stackSizes.h\n*      @author Prithvi Bhat\n"
+            "*      @brief Stack sizes for createThread, generated by tools/stackUsage.py\n"
+            "*               Sizes of unbounded threads are kept from the previous file, edit those by hand\n"
+            "*               Worst-case call depth plus %d bytes of context switch frame, rounded to 8 bytes\n**/\n\n"
+            "#ifndef STACK_SIZES_H\n#define STACK_SIZES_H\n\n%s\n\n#endif\n" % (FRAME_BYTES, "\n".join(lines)))
+    if not os.path.exists(out) or open(out).read() != text:
+        with open(out, "w") as header:
+            header.write(text)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,146 @@
+/**
+*      @file tlsfBench.c
+*      @author Prithvi Bhat
+*      @brief Host benchmark of the TLSF thread heap in tlsf.c against a naive first-fit allocator
+*               Both allocators run the same random mix of requests and releases in a 16K heap and every request is
+*               timed. The host is not real-time, so the tail is given as the 99.9th percentile rather than the
+*               single slowest call. The first-fit walk length is counted too: it is the deterministic part of the
+*               first-fit worst case and grows with fragmentation, while TLSF does a fixed amount of work
+*
+*      Build and run (from the repository root):
+*          gcc -std=gnu99 -O2 -I. tools/tlsfBench.c tlsf.c -o tlsfBench && ./tlsfBench
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "tlsf.h"
+
+#define HEAP_BYTES          16000       // Within the largest TLSF block
+#define SLOTS               32          // Allocations held at once, about half the heap
+#define ROUNDS              200000
+#define MAX_REQUEST         512
+
+// Stand-ins for the assembly helpers in systemRegisters.s
+uint32_t countLeadingZeros(uint32_t value)  { return value ? __builtin_clz(value) : 32; }
+uint32_t countTrailingZeros(uint32_t value) { return value ? __builtin_ctz(value) : 32; }
+
+/**
+*      @brief Header of a first-fit block, blocks follow each other through the whole heap
+**/
+typedef struct
+{
+    uint32_t size;                      // Payload bytes
+    uint32_t free;                      // 1 if the block is free
+} fitBlock_t;
+
+uint8_t *fitHeap;
+uint32_t fitWalk, fitWalkMax;
+
+void fitInit(void *memory, uint32_t bytes)
+{
+    fitHeap = memory;
+    ((fitBlock_t *)fitHeap)->size = bytes - sizeof(fitBlock_t);
+    ((fitBlock_t *)fitHeap)->free = 1;
+}
+
+/**
+*      @brief First fit from the bottom of the heap, joining free neighbours on the way
+**/
+void *fitMalloc(uint32_t size, uint32_t bytes)
+{
+    uint8_t *at = fitHeap, *end = fitHeap + bytes;
+    fitBlock_t *block, *next;
+
+    size = (size + 7) & ~7;
+    for (fitWalk = 1; at < end; fitWalk++, at += sizeof(fitBlock_t) + block->size)
+    {
+        block = (fitBlock_t *)at;
+        if (!block->free)   continue;
+
+        next = (fitBlock_t *)(at + sizeof(fitBlock_t) + block->size);
+        while ((uint8_t *)next < end && next->free)                             // Merge the free run ahead
+        {
+            block->size += sizeof(fitBlock_t) + next->size;
+            next = (fitBlock_t *)(at + sizeof(fitBlock_t) + block->size);
+        }
+
+        if (block->size < size)     continue;
+
+        if (block->size >= size + sizeof(fitBlock_t) + 8)                       // Split off the rest
+        {
+            next = (fitBlock_t *)(at + sizeof(fitBlock_t) + size);
+            next->size = block->size - size - sizeof(fitBlock_t);
+            next->free = 1;
+            block->size = size;
+        }
+        block->free = 0;
+        if (fitWalk > fitWalkMax)   fitWalkMax = fitWalk;
+        return at + sizeof(fitBlock_t);
+    }
+    if (fitWalk > fitWalkMax)   fitWalkMax = fitWalk;
+    return NULL;
+}
+
+void fitFree(void *ptr)
+{
+    if (ptr)    ((fitBlock_t *)((uint8_t *)ptr - sizeof(fitBlock_t)))->free = 1;
+}
+
+uint64_t now(void)
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t)time.tv_sec * 1000000000 + time.tv_nsec;
+}
+
+int compare(const void *a, const void *b)
+{
+    return (*(const uint32_t *)a > *(const uint32_t *)b) - (*(const uint32_t *)a < *(const uint32_t *)b);
+}
+
+/**
+*      @brief Run the same workload on one allocator
+*      @param tlsf heap control structure, NULL to run first fit
+**/
+void run(const char *name, tlsf_t *tlsf)
+{
+    static uint32_t times[ROUNDS];
+    void *held[SLOTS] = {0};
+    uint64_t start, total = 0;
+    uint32_t round, slot, failed = 0;
+
+    srand(7);
+    for (round = 0; round < ROUNDS; round++)
+    {
+        slot = rand() % SLOTS;
+        if (held[slot])                                                         // Release whatever the slot holds
+        {
+            if (tlsf)   tlsfFree(tlsf, held[slot]);
+            else        fitFree(held[slot]);
+        }
+
+        start = now();
+        held[slot] = tlsf ? tlsfMalloc(tlsf, 8 + rand() % MAX_REQUEST) : fitMalloc(8 + rand() % MAX_REQUEST, HEAP_BYTES);
+        times[round] = now() - start;
+
+        total += times[round];
+        if (!held[slot])        failed++;
+    }
+
+    qsort(times, ROUNDS, sizeof(times[0]), compare);
+    printf("%-10s average %6.1f ns  99.9%% %6u ns  failed %u", name, (double)total / ROUNDS, times[ROUNDS - ROUNDS / 1000], failed);
+    if (tlsf)   printf("\n");
+    else        printf("  longest walk %u blocks\n", fitWalkMax);
+}
+
+int main(void)
+{
+    static uint64_t memory[HEAP_BYTES / 8];
+
+    run("tlsf", tlsfInit(memory, HEAP_BYTES));
+
+    fitInit(memory, HEAP_BYTES);
+    run("first-fit", NULL);
+    return 0;
+}
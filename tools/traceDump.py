@@ -0,0 +1,77 @@
+#!/usr/bin/env python3
+"""
+    @file traceDump.py
+    @author Prithvi Bhat
+    @brief Decoder for the binary frames sent by the trace shell command
+
+    Capture the raw UART output of the trace command to a file with any terminal that can log binary data,
+    then decode it. Text around the frames is skipped, and frames with a bad checksum are dropped.
+
+    Usage (from the repository root):
+        python3 tools/traceDump.py capture.bin
+
+    The frame layout and event types are described in trace.h.
+"""
+
+import argparse
+import struct
+import sys
+
+SYNC = b"\x7eT"
+RECORD = struct.Struct("<IBBH")                                 # time, event, task, object
+COUNTS_PER_US = 40                                              # WTIMER0 counts at the 40 MHz system clock
+
+EVENTS = {1: "switch", 2: "svc", 3: "wake", 4: "preempt", 5: "miss"}
+STATES = {0: "invalid", 1: "stopped", 2: "unrun", 3: "ready", 4: "delayed", 5: "mutex", 6: "semaphore",
+          7: "join", 8: "job", 9: "throttled"}
+
+
+def read_frames(data):
+    """Yield the sequence and records of every valid frame, stopping at the empty frame"""
+    position = data.find(SYNC)
+    while position >= 0 and position + 7 <= len(data):
+        count = data[position + 2]
+        end = position + 7 + count * RECORD.size + 1
+        frame = data[position + 2:end]
+        if end <= len(data) and sum(frame) & 0xFF == 0:
+            if not count:
+                return
+            sequence = struct.unpack_from("<I", frame, 1)[0]
+            yield sequence, [RECORD.unpack_from(frame, 5 + i * RECORD.size) for i in range(count)]
+            position = data.find(SYNC, end)
+        else:
+            position = data.find(SYNC, position + 1)            # Sync bytes inside text or a damaged frame
+
+
+def describe(event, obj):
+    """Event specific value in words"""
+    if event == 1:
+        return "from task %d (%s)" % (obj >> 8, STATES.get(obj & 0xFF, obj & 0xFF))
+    if event == 2:
+        return "0x%02X" % obj
+    if event == 5:
+        return "%d misses" % obj
+    return ""
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("@brief")[1].splitlines()[0].strip())
+    parser.add_argument("capture")
+    args = parser.parse_args()
+
+    expected, start = None, None
+    for sequence, records in read_frames(open(args.capture, "rb").read()):
+        if expected is not None and sequence != expected:
+            print("-- %d records lost --" % ((sequence - expected) & 0xFFFFFFFF))
+        expected = sequence + len(records)
+        for time, event, task, obj in records:
+            start = time if start is None else start
+            print("%12.3f us  %-8s task %-3d %s" % (((time - start) & 0xFFFFFFFF) / COUNTS_PER_US,
+                                                    EVENTS.get(event, event), task, describe(event, obj)))
+
+    if start is None:
+        sys.exit("traceDump: no trace frames found")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,95 @@
+/**
+*      @file trace.c
+*      @author Prithvi Bhat
+*      @brief Kernel trace ring
+*               The kernel writes a fixed-size binary record for every context switch, service call and tick event
+*               The ring overwrites its oldest records, so it always holds the events leading up to a problem
+*               Writing a record takes a few instructions, so tracing does not hide microsecond scale behaviour
+**/
+
+#include <stdint.h>
+#include "trace.h"
+#include "uart0.h"
+#include "systemRegisters.h"
+
+#if CONFIG_TRACE
+
+// Global variables
+traceRecord_t trace_g[TRACE_RECORDS];                                           // Ring of records, oldest overwritten first
+uint32_t traceHead_g = 0;                                                       // Sequence of the next record written
+
+/**
+*      @brief Function to add a record to the ring
+*               Must be called with privileges (handler mode or kernel)
+*      @param event type of the event
+*      @param task index of the TCB record
+*      @param object event specific value
+*      @param time kernel time of the event
+**/
+void traceEvent(uint8_t event, uint8_t task, uint16_t object, uint32_t time)
+{
+    uint32_t primask = disableInterrupts();                                     // Nested handlers must not share a slot
+    traceRecord_t *record = &trace_g[traceHead_g++ & (TRACE_RECORDS - 1)];
+
+    record->time    = time;
+    record->event   = event;
+    record->task    = task;
+    record->object  = object;
+    restoreInterrupts(primask);
+}
+
+/**
+*      @brief Function to copy the next run of records out of the ring
+*               Must be called with privileges (handler mode or kernel)
+*      @param chunk position in the ring on entry, the records copied on return
+**/
+void copyTrace(traceChunk_t *chunk)
+{
+    uint32_t primask = disableInterrupts();                                     // Keep the ring still while copying
+
+    if (!chunk->end)    chunk->end = traceHead_g;                               // Fix the end so new records do not prolong the dump
+    if (traceHead_g - chunk->next > TRACE_RECORDS)  chunk->next = traceHead_g - TRACE_RECORDS;  // Skip what was overwritten
+
+    chunk->first = chunk->next;
+    for (chunk->count = 0; chunk->count < TRACE_CHUNK && (int32_t)(chunk->end - chunk->next) > 0; chunk->count++)  // Done once past the end
+    {
+        chunk->records[chunk->count] = trace_g[chunk->next++ & (TRACE_RECORDS - 1)];
+    }
+    restoreInterrupts(primask);
+}
+
+/**
+*      @brief Function to send bytes over UART0 and add them to a frame checksum
+*      @param data bytes to send
+*      @param length number of bytes
+*      @param sum running checksum
+**/
+void putTraceBytes(const void *data, uint8_t length, uint8_t *sum)
+{
+    const uint8_t *byte = (const uint8_t *)data;
+
+    while (length--)
+    {
+        *sum += *byte;
+        putcUart0(*byte++);
+    }
+}
+
+/**
+*      @brief Function to send a chunk of records as one frame over UART0
+*               The records are sent in memory order, which is little endian on the Cortex-M4
+*      @param chunk records to send
+**/
+void putTraceFrame(const traceChunk_t *chunk)
+{
+    uint8_t sum = 0;
+
+    putcUart0(TRACE_FRAME_SYNC);
+    putcUart0(TRACE_FRAME_TYPE);
+    putTraceBytes(&chunk->count, 1, &sum);
+    putTraceBytes(&chunk->first, 4, &sum);
+    putTraceBytes(chunk->records, chunk->count * sizeof(traceRecord_t), &sum);
+    putcUart0(-sum);                                                            // Frame bytes now sum to zero
+}
+
+#endif
@@ -0,0 +1,66 @@
+/**
+*      @file trace.h
+*      @author Prithvi Bhat
+*      @brief Header file for the kernel trace ring
+*               The trace command sends the ring as frames of binary records, decoded by tools/traceDump.py
+*               Frame: 0x7E 'T' | count | sequence of the first record (4 bytes) | count records | checksum
+*               Multi-byte fields are little endian, and the bytes after 'T' including the checksum sum to zero
+*               A frame with no records ends the dump, gaps in the sequence are records overwritten before they were sent
+**/
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include "kernelConfig.h"
+
+#define TRACE_CHUNK         8           // Records sent per frame
+
+#define TRACE_FRAME_SYNC    0x7E        // First byte of every frame
+#define TRACE_FRAME_TYPE    'T'         // Second byte of every frame
+
+// Event types
+#define TRACE_SWITCH        0x01        // task switched in, object = task switched out << 8 | its state
+#define TRACE_SVC           0x02        // task made a service call, object = SVC number
+#define TRACE_WAKE          0x03        // sleeping task made ready by the tick
+#define TRACE_PREEMPT       0x04        // tick asked to reschedule the running task
+#define TRACE_MISS          0x05        // periodic task passed its deadline, object = misses so far
+
+/**
+*      @brief Structure to hold one trace record (8 bytes)
+**/
+typedef struct
+{
+    uint32_t time;                      // Kernel time in timer counts (25 ns), wraps every 107 s
+    uint8_t event;                      // One of the TRACE_ event types
+    uint8_t task;                       // Index of the TCB record
+    uint16_t object;                    // Event specific value
+} traceRecord_t;
+
+// Kernel SRAM taken by the ring, counted by the kernel SRAM budget check in kernel.c
+#if CONFIG_TRACE
+#define TRACE_SRAM_BYTES    (TRACE_RECORDS * sizeof(traceRecord_t))
+#else
+#define TRACE_SRAM_BYTES    0
+#endif
+
+/**
+*      @brief Structure to hold a run of records copied out of the ring for the trace command
+**/
+typedef struct
+{
+    uint32_t next;                      // Sequence to copy from, advanced past the records copied
+    uint32_t end;                       // Sequence to stop at, 0 to stop at the newest record now
+    uint32_t first;                     // Sequence of records[0]
+    uint8_t count;                      // Records copied, 0 once end is reached
+    traceRecord_t records[TRACE_CHUNK];
+} traceChunk_t;
+
+void putTraceFrame(const traceChunk_t *chunk);
+
+// Kernel side, called with privileges
+void traceEvent(uint8_t event, uint8_t task, uint16_t object, uint32_t time);
+void copyTrace(traceChunk_t *chunk);
+
+#endif
@@ -0,0 +1,148 @@
+/**
+*      @file workers.c
+*      @author Prithvi Bhat
+*      @brief Worker thread pool fed by a job queue
+*               A fixed set of threads is created once at start up and sleeps in the kernel until work arrives,
+*               so bursts of work cost a queue entry instead of a thread creation and a stack per job type
+*               Jobs run unprivileged on a worker stack, their argument must be a value or point to memory
+*               the workers can reach (for example a shared memory window)
+**/
+
+#include <stdint.h>
+#include "tm4c123gh6pm.h"
+#include "workers.h"
+#include "kernel.h"
+#include "faults.h"
+#include "systemRegisters.h"
+
+#if CONFIG_WORKERS
+
+#define NULL    0x00000000
+
+// Global variables
+job_t jobQueue_g[MAX_JOBS];                                                     // Ring of jobs waiting for a worker
+uint8_t jobHead_g = 0;                                                          // Oldest job in the ring
+uint8_t jobCount_g = 0;                                                         // Number of jobs in the ring
+
+/**
+*      @brief Function to add a job to the tail of the queue
+*               Must be called with privileges (handler mode or kernel)
+*      @param job to be copied into the queue
+*      @return true if the job was queued, false if the queue is full
+**/
+bool enqueueJob(const job_t *job)
+{
+    uint32_t primask = disableInterrupts();                                     // Keep ISRs out of the ring
+    bool ok = (jobCount_g < MAX_JOBS);
+
+    if (ok)     jobQueue_g[(jobHead_g + jobCount_g++) % MAX_JOBS] = *job;
+
+    restoreInterrupts(primask);
+    return ok;
+}
+
+/**
+*      @brief Function to take the job at the head of the queue
+*               Must be called with privileges (handler mode or kernel)
+*      @param job location to copy the job to
+*      @return true if a job was taken, false if the queue is empty
+**/
+bool dequeueJob(job_t *job)
+{
+    uint32_t primask = disableInterrupts();                                     // Keep ISRs out of the ring
+    bool ok = (jobCount_g > 0);
+
+    if (ok)
+    {
+        *job = jobQueue_g[jobHead_g];
+        jobHead_g = (jobHead_g + 1) % MAX_JOBS;
+        jobCount_g--;
+    }
+
+    restoreInterrupts(primask);
+    return ok;
+}
+
+/**
+*      @brief Service call to queue a job on behalf of an unprivileged thread
+*      @param job to be queued
+*      @param ok location to store whether the job was queued
+**/
+void requestJob(const job_t *job, bool *ok)
+{
+    __asm(" SVC #0x22");                                    // Trigger a Service call
+}
+
+/**
+*      @brief Service call to wait for the next job, the worker blocks while the queue is empty
+*      @param job location the kernel copies the job to
+**/
+void takeJob(job_t *job)
+{
+    __asm(" SVC #0x23");                                    // Trigger a Service call
+}
+
+/**
+*      @brief Thread body shared by every worker
+**/
+void workerThread(void)
+{
+    job_t job;
+
+    while (true)
+    {
+        takeJob(&job);                                                          // Sleeps until there is work
+        job.fn(job.arg);
+
+        if (job.semaphore != NO_NOTIFY)     post(job.semaphore);                // Tell the submitter it is done
+    }
+}
+
+/**
+*      @brief Function to create the worker threads
+*               Must be called with privileges, before startRtos
+*      @param count number of workers (at most MAX_WORKERS)
+*      @param priority of every worker
+*      @param stackBytes stack of every worker, sized for the deepest job
+*      @return true if every worker was created
+**/
+bool initWorkers(uint8_t count, uint8_t priority, uint32_t stackBytes)
+{
+    bool ok = (count <= MAX_WORKERS);
+    uint8_t i;
+
+    for (i = 0; ok && i < count; i++)
+    {
+        ok = (createThreadWithArg(workerThread, NULL, "Worker", priority, stackBytes) != 0);
+    }
+    return ok;
+}
+
+/**
+*      @brief Function to hand a job to the worker pool
+*               Safe to call from threads and ISRs, a waiting worker picks the job up at the next context switch
+*      @param fn function to run
+*      @param arg argument handed to the function
+*      @param semaphore posted by the worker when the job is done, NO_NOTIFY for none
+*      @return true if the job was queued, false if the queue is full
+**/
+bool submitJob(_job fn, void *arg, int8_t semaphore)
+{
+    job_t job = {fn, arg, semaphore};
+    bool ok = false;
+
+    if (IN_PRIVILEGED_CONTEXT())
+    {
+        ok = enqueueJob(&job);
+        dispatchJobs();                                                         // Wake a waiting worker
+        if (getIPSR())  enablePendSV();                                         // Only once the RTOS is running
+    }
+    else
+    {
+        requestJob(&job, &ok);
+    }
+
+    return ok;
+}
+
+#endif
@@ -0,0 +1,42 @@
+/**
+*      @file workers.h
+*      @author Prithvi Bhat
+*      @brief Header file for the worker thread pool and its job queue
+**/
+
+#ifndef WORKERS_H
+#define WORKERS_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include "kernelConfig.h"
+
+#define NO_NOTIFY           -1          // Semaphore value for jobs nobody waits on
+
+typedef void (*_job)(void *arg);
+
+/**
+*      @brief Structure to hold a job waiting for a worker
+**/
+typedef struct
+{
+    _job fn;                            // Function run by the worker
+    void *arg;                          // Argument handed to the function
+    int8_t semaphore;                   // Posted when the job is done, NO_NOTIFY for none
+} job_t;
+
+// Kernel SRAM taken by the job queue, counted by the kernel SRAM budget check in kernel.c
+#if CONFIG_WORKERS
+#define WORKERS_SRAM_BYTES  (MAX_JOBS * sizeof(job_t))
+#else
+#define WORKERS_SRAM_BYTES  0
+#endif
+
+bool initWorkers(uint8_t count, uint8_t priority, uint32_t stackBytes);
+bool submitJob(_job fn, void *arg, int8_t semaphore);
+
+// Kernel side, called with privileges
+bool enqueueJob(const job_t *job);
+bool dequeueJob(job_t *job);
+
+#endif